@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+"""
+Run this program as `py/bench.py build/tests/t-simple-pass`
+              or as `py/bench.py build/tests/t-simple-pass --repeat 10 -- --jobs 4`
+
+Runs the test binary with every available launcher and compares the
+statistics printed by `--stats`.
+"""
+
+import subprocess
+import sys
+
+LAUNCHERS = [
+    ('fork', []),
+    ('spawn', ['--spawn']),
+]
+
+
+def statistics(binary, arguments):
+    p = subprocess.Popen([binary, '--no-color', '--stats'] + arguments,
+                         stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    output, _ = p.communicate()
+    values = {}
+    inside = False
+    for line in output.decode('utf-8', 'replace').splitlines():
+        if line == 'Statistics:':
+            inside = True
+            continue
+        if not inside or ':' not in line:
+            continue
+        key, value = line.split(':', 1)
+        values[key.strip()] = value.split()[0]
+    return values
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('invalid number of arguments')
+        sys.exit(1)
+
+    binary = sys.argv[1]
+    repeat = 5
+    extra = []
+    rest = sys.argv[2:]
+    if '--' in rest:
+        extra = rest[rest.index('--') + 1:]
+        rest = rest[:rest.index('--')]
+    if len(rest) == 2 and rest[0] == '--repeat':
+        repeat = int(rest[1])
+
+    print('{:<8} {:>14} {:>14} {:>12}'.format('launcher', 'launch ms/unit', 'unit ms/unit', 'wall s'))
+    for name, arguments in LAUNCHERS:
+        launch = []
+        runtime = []
+        wall = []
+        for _ in range(repeat):
+            values = statistics(binary, arguments + extra)
+            if values.get('launcher') != name:
+                break
+            launch.append(float(values['launch']))
+            runtime.append(float(values['runtime']))
+            wall.append(float(values['wall time']))
+        if not wall:
+            print('{:<8} {:>14}'.format(name, 'n/a'))
+            continue
+        print('{:<8} {:>14.3f} {:>14.3f} {:>12.3f}'.format(
+            name, min(launch), min(runtime), min(wall)))
+
+
+if __name__ == '__main__':
+    main()
@@ -19,16 +19,29 @@ class TestRunner(object):
         self._outputDir = outputDir
         self._statusUnknown = True
 
+    def _arguments(self, suffix='args'):
+        try:
+            with open(os.path.join(self._outputDir, '{}.{}'.format(self._testName, suffix)), 'r') as f:
+                return f.read().split()
+        except (OSError, IOError):
+            return None if suffix == 'before' else []
+
+    def _command(self, arguments):
+        return [
+            os.path.join(self._testDir, self._test),
+            '--no-color',
+            '--short-path',
+            '{}'.format(len(self._testName))
+        ] + arguments
+
     def check(self, bootstrap):
         try:
             print('running {}: '.format(self._test), end='')
-            p = subprocess.Popen([
-                    os.path.join(self._testDir, self._test),
-                    '--no-color',
-                    '--short-path',
-                    '{}'.format(len(self._testName))
-                ],
-                stdout=subprocess.PIPE)
+            # a run which leaves files for the checked one, its output and exit code do not matter
+            before = self._arguments('before')
+            if before is not None:
+                subprocess.call(self._command(before), stdout=subprocess.DEVNULL)
+            p = subprocess.Popen(self._command(self._arguments()), stdout=subprocess.PIPE)
             output, err = p.communicate()
             print(self._status(p.returncode))
 
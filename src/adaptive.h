@@ -0,0 +1,150 @@
+#ifndef CUT_ADAPTIVE_H
+#define CUT_ADAPTIVE_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+/* With --adaptive-jobs the runner keeps slots for max units, but starts new
+   processes only while fewer than the current limit are running. The limit
+   starts at the number of online CPUs (within bounds) and moves by one each
+   sampling period: down when the machine stalls on CPU, memory or I/O, up when
+   it is calm and units wait for a slot. The load average is taken without the
+   units of the runner, otherwise the load they make would hold the limit down.
+   Units already running are never stopped, a lowered limit only holds new ones
+   back.
+ */
+
+#define CUT_SCALING_PERIOD 2000000
+#define CUT_STALL_CPU 40.0
+#define CUT_STALL_MEMORY 10.0
+#define CUT_STALL_IO 30.0
+#define CUT_STALL_LOAD 1.5
+#define CUT_CALM_CPU 10.0
+#define CUT_CALM_MEMORY 1.0
+#define CUT_CALM_IO 5.0
+#define CUT_CALM_LOAD 0.9
+
+CUT_PRIVATE void cut_StartScaling() {
+    if (!cut_arguments.minJobs)
+        return;
+    int jobs = cut_ProcessorCount();
+    if (jobs < cut_arguments.minJobs)
+        jobs = cut_arguments.minJobs;
+    if (jobs > cut_arguments.maxJobs)
+        jobs = cut_arguments.maxJobs;
+    cut_scaling.jobs = jobs;
+    cut_scaling.lowest = jobs;
+    cut_scaling.highest = jobs;
+    cut_scaling.sampled = cut_Now();
+}
+
+CUT_PRIVATE int cut_ProcessesRunning() {
+    int running = 0;
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        const struct cut_Slot *slot = &cut_schedule.slots[i];
+        running += slot->state == cut_SLOT_RUNNING && !slot->thread;
+    }
+    return running;
+}
+
+CUT_PRIVATE void cut_AdaptJobs() {
+    if (!cut_arguments.minJobs)
+        return;
+    int64_t now = cut_Now();
+    if (now - cut_scaling.sampled < CUT_SCALING_PERIOD)
+        return;
+    cut_scaling.sampled = now;
+    struct cut_Pressure pressure;
+    if (!cut_ReadPressure(&pressure))
+        return;
+
+    int running = cut_ProcessesRunning();
+    // the load counts the units of the runner as well, the limit follows the rest of the machine
+    double foreignLoad = pressure.load;
+    if (foreignLoad >= 0) {
+        foreignLoad -= (double)running / cut_ProcessorCount();
+        // the average of the last minute lags behind units just started
+        if (foreignLoad < 0)
+            foreignLoad = 0;
+    }
+    int stalled = pressure.cpu > CUT_STALL_CPU || pressure.memory > CUT_STALL_MEMORY
+               || pressure.io > CUT_STALL_IO || foreignLoad > CUT_STALL_LOAD;
+    int calm = pressure.cpu < CUT_CALM_CPU && pressure.memory < CUT_CALM_MEMORY
+            && pressure.io < CUT_CALM_IO && foreignLoad < CUT_CALM_LOAD;
+    // more jobs are of use only when the limit is what keeps units waiting
+    int starved = cut_schedule.queue.head < cut_schedule.queue.size && running >= cut_scaling.jobs;
+    int jobs = cut_scaling.jobs;
+    if (stalled && jobs > cut_arguments.minJobs)
+        --jobs;
+    else if (calm && starved && jobs < cut_arguments.maxJobs)
+        ++jobs;
+    if (jobs == cut_scaling.jobs)
+        return;
+
+    if (cut_scaling.size == cut_scaling.capacity) {
+        cut_scaling.capacity += 64;
+        cut_scaling.steps = (struct cut_ScalingStep *)realloc(cut_scaling.steps,
+            sizeof(struct cut_ScalingStep) * cut_scaling.capacity);
+        if (!cut_scaling.steps)
+            cut_FatalExit("cannot allocate memory for scaling log");
+    }
+    struct cut_ScalingStep *step = &cut_scaling.steps[cut_scaling.size++];
+    step->time = now - cut_schedule.started;
+    step->from = cut_scaling.jobs;
+    step->jobs = jobs;
+    step->pressure = pressure;
+    cut_scaling.jobs = jobs;
+    if (jobs < cut_scaling.lowest)
+        cut_scaling.lowest = jobs;
+    if (jobs > cut_scaling.highest)
+        cut_scaling.highest = jobs;
+}
+
+CUT_PRIVATE int cut_JobsAvailable(const struct cut_Slot *slot) {
+    if (!cut_arguments.minJobs || slot->thread)
+        return 1;
+    return cut_ProcessesRunning() < cut_scaling.jobs;
+}
+
+CUT_PRIVATE int cut_ScalingTimeout() {
+    if (!cut_arguments.minJobs)
+        return -1;
+    int64_t remaining = cut_scaling.sampled + CUT_SCALING_PERIOD - cut_Now();
+    return remaining > 0 ? (int)((remaining + 999) / 1000) : 0;
+}
+
+CUT_PRIVATE void cut_PrintPressure(const char *name, double value) {
+    if (value < 0)
+        fprintf(cut_output, " %s -", name);
+    else
+        fprintf(cut_output, " %s %.1f%%", name, value);
+}
+
+CUT_PRIVATE void cut_PrintScaling() {
+    if (!cut_arguments.minJobs)
+        return;
+    fprintf(cut_output, "  jobs:      %i to %i (bounds %i:%i), %i change%s\n",
+            cut_scaling.lowest, cut_scaling.highest, cut_arguments.minJobs, cut_arguments.maxJobs,
+            cut_scaling.size, cut_scaling.size == 1 ? "" : "s");
+    for (int i = 0; i < cut_scaling.size; ++i) {
+        const struct cut_ScalingStep *step = &cut_scaling.steps[i];
+        fprintf(cut_output, "    %8.3f s: %i -> %i jobs,", step->time / 1000000.0, step->from, step->jobs);
+        cut_PrintPressure("cpu", step->pressure.cpu);
+        cut_PrintPressure("memory", step->pressure.memory);
+        cut_PrintPressure("io", step->pressure.io);
+        if (step->pressure.load < 0)
+            fprintf(cut_output, " load -\n");
+        else
+            fprintf(cut_output, " load %.2f\n", step->pressure.load);
+    }
+}
+
+CUT_PRIVATE void cut_CleanScaling() {
+    free(cut_scaling.steps);
+    cut_scaling.steps = NULL;
+    cut_scaling.size = 0;
+    cut_scaling.capacity = 0;
+}
+
+#endif // CUT_ADAPTIVE_H
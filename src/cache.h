@@ -0,0 +1,180 @@
+#ifndef CUT_CACHE_H
+#define CUT_CACHE_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+/* The cache file keeps one line per passed unit:
+     <test name> <subtest> <key> <subtests> <number> <subtest name or ->
+   The key is a hash of the code of the test, a test is skipped only when
+   all its units passed with the very same key.
+ */
+
+CUT_PRIVATE struct cut_CacheEntry *cut_FindCache(const char *name, int subtest) {
+    int found;
+    int position = cut_RecordPosition(cut_cache.entries, cut_cache.size, sizeof(struct cut_CacheEntry),
+                                      name, subtest, &found);
+    return found ? &cut_cache.entries[position] : NULL;
+}
+
+CUT_PRIVATE struct cut_CacheEntry *cut_AddCache(const char *name, int subtest) {
+    return (struct cut_CacheEntry *)cut_InsertRecord((void **)&cut_cache.entries, &cut_cache.size,
+        &cut_cache.capacity, sizeof(struct cut_CacheEntry), name, subtest);
+}
+
+CUT_PRIVATE void cut_SetCacheTitle(struct cut_CacheEntry *entry, const char *title) {
+    free(entry->title);
+    entry->title = NULL;
+    if (!title)
+        return;
+    entry->title = (char *)malloc(strlen(title) + 1);
+    if (!entry->title)
+        cut_FatalExit("cannot allocate memory for cache");
+    strcpy(entry->title, title);
+}
+
+CUT_PRIVATE void cut_LoadCache() {
+    // a single selected subtest does not tell anything about the whole test
+    if (!cut_arguments.cache || cut_arguments.subtestId >= 0)
+        return;
+    cut_cache.keys = (uint64_t *)malloc(sizeof(uint64_t) * (cut_unitTests.size + 1));
+    if (!cut_cache.keys)
+        cut_FatalExit("cannot allocate memory for cache");
+    if (!cut_HashTests(cut_cache.keys)) {
+        fprintf(stderr, "Cannot read code of tests, the cache is not used.\n");
+        free(cut_cache.keys);
+        cut_cache.keys = NULL;
+        return;
+    }
+    cut_MakeDirectory(cut_arguments.cache)
+        || cut_ErrorExit("cannot create directory %s", cut_arguments.cache);
+
+    const char *base = cut_arguments.selfName;
+    for (const char *c = base; *c; ++c) {
+        if (*c == '/' || *c == '\\')
+            base = c + 1;
+    }
+    cut_cache.file = (char *)malloc(strlen(cut_arguments.cache) + strlen(base) + 8);
+    if (!cut_cache.file)
+        cut_FatalExit("cannot allocate memory for cache");
+    sprintf(cut_cache.file, "%s/%s.cache", cut_arguments.cache, base);
+
+    FILE *file = fopen(cut_cache.file, "r");
+    if (!file)
+        return;
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        if (*line == '#')
+            continue;
+        char *name = strtok(line, " \t\r\n");
+        char *subtest = strtok(NULL, " \t\r\n");
+        char *key = strtok(NULL, " \t\r\n");
+        char *subtests = strtok(NULL, " \t\r\n");
+        char *number = strtok(NULL, " \t\r\n");
+        // names of subtests may contain spaces, they take the rest of the line
+        char *title = strtok(NULL, "\r\n");
+        if (!name || !subtest || !key || !subtests || !number || !title)
+            continue;
+        struct cut_CacheEntry *entry = cut_AddCache(name, atoi(subtest));
+        entry->key = strtoull(key, NULL, 16);
+        entry->subtests = atoi(subtests);
+        entry->number = atoi(number);
+        cut_SetCacheTitle(entry, strcmp(title, "-") ? title : NULL);
+    }
+    fclose(file);
+}
+
+CUT_PRIVATE void cut_SaveCache() {
+    if (!cut_cache.file)
+        return;
+    size_t length = strlen(cut_cache.file);
+    char *temporary = (char *)malloc(length + 5);
+    if (!temporary)
+        cut_FatalExit("cannot allocate memory for cache");
+    sprintf(temporary, "%s.tmp", cut_cache.file);
+    FILE *file = fopen(temporary, "w");
+    if (!file) {
+        free(temporary);
+        cut_ErrorExit("cannot open file %s for writing", cut_cache.file);
+    }
+    fprintf(file, "# CUT cache 1\n");
+    for (int i = 0; i < cut_cache.size; ++i) {
+        const struct cut_CacheEntry *entry = &cut_cache.entries[i];
+        if (entry->failed)
+            continue;
+        fprintf(file, "%s %d %016llx %d %d %s\n",
+                entry->record.name, entry->record.subtest, (unsigned long long)entry->key,
+                entry->subtests, entry->number, entry->title ? entry->title : "-");
+    }
+    fclose(file) != EOF || cut_ErrorExit("cannot write file %s", cut_cache.file);
+    rename(temporary, cut_cache.file) != -1
+        || cut_ErrorExit("cannot replace file %s", cut_cache.file);
+    free(temporary);
+}
+
+CUT_PRIVATE int cut_CachedTest(int testId) {
+    // repeated runs are wanted exactly because a single pass tells little
+    if (!cut_cache.keys || cut_arguments.noCache || cut_arguments.repeat)
+        return 0;
+    const char *name = cut_unitTests.tests[testId].name;
+    uint64_t key = cut_cache.keys[testId];
+    const struct cut_CacheEntry *first = cut_FindCache(name, 0);
+    if (!first || first->key != key)
+        return 0;
+    for (int subtest = 1; subtest <= first->subtests; ++subtest) {
+        const struct cut_CacheEntry *entry = cut_FindCache(name, subtest);
+        if (!entry || entry->key != key)
+            return 0;
+    }
+
+    struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+    cut_ReserveResults(progress, first->subtests);
+    progress->subtests = first->subtests;
+    progress->cached = 1;
+    for (int subtest = 0; subtest <= first->subtests; ++subtest) {
+        const struct cut_CacheEntry *entry = cut_FindCache(name, subtest);
+        struct cut_UnitResult *result = &progress->results[subtest];
+        memset(result, 0, sizeof(*result));
+        result->cached = 1;
+        result->subtests = subtest ? 0 : first->subtests;
+        result->number = entry->number;
+        if (entry->title) {
+            result->name = (char *)malloc(strlen(entry->title) + 1);
+            if (!result->name)
+                cut_FatalExit("cannot allocate memory for cache");
+            strcpy(result->name, entry->title);
+        }
+        progress->finished[subtest] = 1;
+    }
+    ++cut_schedule.cached;
+    return 1;
+}
+
+CUT_PRIVATE void cut_RecordCache(int testId, int subtest, const struct cut_UnitResult *result) {
+    if (!cut_cache.keys || result->cached)
+        return;
+    struct cut_CacheEntry *entry = cut_AddCache(cut_unitTests.tests[testId].name, subtest);
+    entry->key = cut_cache.keys[testId];
+    entry->failed = result->failed;
+    entry->subtests = result->subtests;
+    entry->number = result->number;
+    cut_SetCacheTitle(entry, result->name);
+}
+
+CUT_PRIVATE void cut_CleanCache() {
+    for (int i = 0; i < cut_cache.size; ++i) {
+        free(cut_cache.entries[i].record.name);
+        free(cut_cache.entries[i].title);
+    }
+    free(cut_cache.entries);
+    free(cut_cache.keys);
+    free(cut_cache.file);
+    cut_cache.entries = NULL;
+    cut_cache.keys = NULL;
+    cut_cache.file = NULL;
+    cut_cache.size = 0;
+    cut_cache.capacity = 0;
+}
+
+#endif // CUT_CACHE_H
@@ -1,6 +1,13 @@
 #ifndef CUT_CORE_H
 #define CUT_CORE_H
 
+/* The runner on Linux needs API beyond POSIX (pidfd, namespaces, ...).
+   It has to be requested before the first system header is included.
+ */
+#if defined(CUT_MAIN) && defined(__linux__) && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE
+#endif
+
 /* XXX: make it work on MacOS, broken otherwise due to some intereferences which prevent to define u_XXX types required in sysctl.h
 Should not harm elsewhere.
  */
@@ -14,12 +21,18 @@ Should not harm elsewhere.
 # define CHECK(e) (void)0
 # define CHECK_FILE(f, content) (void)0
 # define TEST(name) static void unitTest_ ## name()
+# define TEST_TIMEOUT(name, ms) static void unitTest_ ## name()
+# define TEST_THREADSAFE(name) static void unitTest_ ## name()
+# define TEST_RESOURCES(name, ...) static void unitTest_ ## name()
 # define GLOBAL_TEAR_UP() static void cut_GlobalTearUpInstance()
 # define GLOBAL_TEAR_DOWN() static void cut_GlobalTearDownInstance()
+# define GLOBAL_SETUP_ONCE() static void cut_GlobalSetupOnceInstance()
 # define SUBTEST(name) if (0)
 # define REPEATED_SUBTEST(name, count) if (0)
 # define SUBTEST_NO 0
 # define DEBUG_MSG(...) (void)0
+# define CUT_PROGRESS() (void)0
+# define cut_Heartbeat(done) (void)0
 
 #else
 
@@ -36,6 +49,22 @@ Should not harm elsewhere.
 #  define CUT_NO_FORK 1
 # endif
 
+# if !defined(CUT_JOBS)
+#  define CUT_JOBS cut_ProcessorCount()
+# endif
+
+# if !defined(CUT_HISTORY)
+#  define CUT_HISTORY NULL
+# endif
+
+# if !defined(CUT_CACHE)
+#  define CUT_CACHE NULL
+# endif
+
+# if !defined(CUT_LAST_RUN)
+#  define CUT_LAST_RUN NULL
+# endif
+
 # if !defined(CUT_NO_COLOR)
 #  define CUT_NO_COLOR !cut_IsTerminalOutput()
 # else
@@ -54,8 +83,12 @@ Should not harm elsewhere.
 #  error "unsupported platform"
 # endif
 
-# define _POSIX_C_SOURCE 199309L
-# define _XOPEN_SOURCE 500
+# if !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 199309L
+# endif
+# if !defined(_XOPEN_SOURCE)
+#  define _XOPEN_SOURCE 500
+# endif
 # include <stdio.h>
 
 # define ASSERT(e) do { if (!(e)) {                                             \
@@ -83,6 +116,31 @@ Should not harm elsewhere.
     }                                                                           \
     void cut_instance_ ## name(CUT_UNUSED(int *cut_subtest), CUT_UNUSED(int cut_current))
 
+# define TEST_TIMEOUT(name, ms)                                                 \
+    void cut_instance_ ## name(int *, int);                                     \
+    CUT_CONSTRUCTOR(cut_Register ## name) {                                     \
+        cut_Register(cut_instance_ ## name, #name, __FILE__, __LINE__);         \
+        cut_RegisterTimeout(cut_instance_ ## name, ms);                         \
+    }                                                                           \
+    void cut_instance_ ## name(CUT_UNUSED(int *cut_subtest), CUT_UNUSED(int cut_current))
+
+# define TEST_THREADSAFE(name)                                                  \
+    void cut_instance_ ## name(int *, int);                                     \
+    CUT_CONSTRUCTOR(cut_Register ## name) {                                     \
+        cut_Register(cut_instance_ ## name, #name, __FILE__, __LINE__);         \
+        cut_RegisterThreadSafe(cut_instance_ ## name);                          \
+    }                                                                           \
+    void cut_instance_ ## name(CUT_UNUSED(int *cut_subtest), CUT_UNUSED(int cut_current))
+
+# define TEST_RESOURCES(name, ...)                                              \
+    void cut_instance_ ## name(int *, int);                                     \
+    CUT_CONSTRUCTOR(cut_Register ## name) {                                     \
+        static const char *resources[] = {__VA_ARGS__, NULL};                   \
+        cut_Register(cut_instance_ ## name, #name, __FILE__, __LINE__);         \
+        cut_RegisterResources(cut_instance_ ## name, resources);                \
+    }                                                                           \
+    void cut_instance_ ## name(CUT_UNUSED(int *cut_subtest), CUT_UNUSED(int cut_current))
+
 # define GLOBAL_TEAR_UP()                                                       \
     void cut_GlobalTearUpInstance();                                            \
     CUT_CONSTRUCTOR(cut_RegisterTearUp) {                                       \
@@ -91,20 +149,28 @@ Should not harm elsewhere.
     void cut_GlobalTearUpInstance()
 
 # define GLOBAL_TEAR_DOWN()                                                     \
-    void cut_GlobalTearUpInstance();                                            \
+    void cut_GlobalTearDownInstance();                                          \
     CUT_CONSTRUCTOR(cut_RegisterTearDown) {                                     \
         cut_RegisterGlobalTearDown(cut_GlobalTearDownInstance);                 \
     }                                                                           \
     void cut_GlobalTearDownInstance()
 
+# define GLOBAL_SETUP_ONCE()                                                    \
+    void cut_GlobalSetupOnceInstance();                                         \
+    CUT_CONSTRUCTOR(cut_RegisterSetupOnce) {                                    \
+        cut_RegisterGlobalSetupOnce(cut_GlobalSetupOnceInstance);               \
+    }                                                                           \
+    void cut_GlobalSetupOnceInstance()
+
 # define SUBTEST(name)                                                          \
-    if (++*cut_subtest == cut_current)                                          \
+    if (++*cut_subtest == cut_current                                           \
+        || cut_Branch(*cut_subtest, *cut_subtest, &cut_current))                \
         cut_Subtest(0, #name);                                                  \
     if (*cut_subtest == cut_current)
 
 # define REPEATED_SUBTEST(name, count)                                          \
     *cut_subtest = (count);                                                     \
-    if (cut_current && count)                                                   \
+    if ((cut_current || cut_Branch(1, count, &cut_current)) && count)           \
         cut_Subtest(cut_current, #name);                                        \
     if (cut_current && count)
 
@@ -112,6 +178,8 @@ Should not harm elsewhere.
 
 # define DEBUG_MSG(...) cut_DebugMessage(__FILE__, __LINE__, __VA_ARGS__)
 
+# define CUT_PROGRESS() cut_Heartbeat(-1)
+
 # ifdef __cplusplus
 extern "C" {
 # endif
@@ -119,20 +187,30 @@ extern "C" {
 typedef void(*cut_Instance)(int *, int);
 typedef void(*cut_GlobalTear)();
 void cut_Register(cut_Instance instance, const char *name, const char *file, size_t line);
+void cut_RegisterTimeout(cut_Instance instance, unsigned timeout);
+void cut_RegisterThreadSafe(cut_Instance instance);
+void cut_RegisterResources(cut_Instance instance, const char **resources);
 void cut_RegisterGlobalTearUp(cut_GlobalTear instance);
 void cut_RegisterGlobalTearDown(cut_GlobalTear instance);
+void cut_RegisterGlobalSetupOnce(cut_GlobalTear instance);
 int cut_File(FILE *file, const char *content);
 CUT_NORETURN void cut_Stop(const char *text, const char *file, size_t line);
 void cut_Check(const char *text, const char *file, size_t line);
 void cut_Subtest(int number, const char *name);
+int cut_Branch(int first, int last, int *current);
 void cut_DebugMessage(const char *file, size_t line, const char *fmt, ...);
+void cut_Heartbeat(int done);
 
 # if defined(CUT_MAIN)
 
 #  include <stdlib.h>
+#  include <stdint.h>
+#  include <limits.h>
 #  include <string.h>
 #  include <setjmp.h>
+#  include <signal.h>
 #  include <stdarg.h>
+#  include <ctype.h>
 
 
 struct cut_Info {
@@ -150,7 +228,12 @@ enum cut_MessageType {
     cut_MESSAGE_FAIL,
     cut_MESSAGE_EXCEPTION,
     cut_MESSAGE_TIMEOUT,
-    cut_MESSAGE_CHECK
+    cut_MESSAGE_CHECK,
+    cut_MESSAGE_BRANCH,
+    cut_MESSAGE_STATUS,
+    cut_MESSAGE_UNIT,
+    cut_MESSAGE_HEARTBEAT,
+    cut_MESSAGE_RESULT
 };
 
 struct cut_UnitResult {
@@ -166,6 +249,12 @@ struct cut_UnitResult {
     int returnCode;
     int signal;
     int timeouted;
+    unsigned timeout;
+    int64_t duration;
+    int64_t memory;
+    int cached;
+    int cancelled;
+    int deferred;
     struct cut_Info *debug;
     struct cut_Info *check;
 };
@@ -175,6 +264,9 @@ struct cut_UnitTest {
     const char *name;
     const char *file;
     size_t line;
+    unsigned timeout;
+    int threadSafe;
+    const char **resources;
 };
 
 struct cut_UnitTestArray {
@@ -183,6 +275,232 @@ struct cut_UnitTestArray {
     struct cut_UnitTest *tests;
 };
 
+struct cut_UnitId {
+    int testId;
+    int subtest;
+    int isolated;
+    int64_t priority;
+};
+
+struct cut_UnitQueue {
+    int head;
+    int size;
+    int capacity;
+    struct cut_UnitId *units;
+};
+
+enum cut_SlotState {
+    cut_SLOT_FREE = 0,
+    cut_SLOT_RUNNING,
+    cut_SLOT_DONE
+};
+
+struct cut_Slot {
+    enum cut_SlotState state;
+    struct cut_UnitId unit;
+    struct cut_UnitResult result;
+    int terminated;
+    int pid;
+    int pipeRead;
+    int pidFd;
+    int eof;
+    int exited;
+    int64_t started;
+    int64_t unitStarted;
+    int64_t deadline;
+    int branchId;
+    int branchPid;
+    int64_t branchStarted;
+    int branchTerminated;
+    struct cut_UnitResult branch;
+    struct cut_UnitId *batch;
+    int batchSize;
+    int batchDone;
+    int64_t memory;
+    int anomaly;
+    int thread;
+    int progress;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+};
+
+struct cut_FailureKind {
+    char *text;
+    int count;
+    int first;
+};
+
+// a unit repeated with no limit keeps a uniform sample of its durations, the extremes of all runs
+#define CUT_REPEAT_SAMPLES 1024
+
+struct cut_UnitStats {
+    int scheduled;
+    int runs;
+    int failures;
+    int firstFailure;
+    int number;
+    char *title;
+    int64_t fastest;
+    int64_t slowest;
+    int sampleCount;
+    int sampleCapacity;
+    int64_t *samples;
+    int kindCount;
+    struct cut_FailureKind *kinds;
+    int kept;
+    struct cut_UnitResult result;
+};
+
+struct cut_TestProgress {
+    int selected;
+    int number;
+    int base;
+    int subtests;
+    int capacity;
+    int printed;
+    int failed;
+    int cached;
+    int cancelled;
+    int deferred;
+    struct cut_UnitResult *results;
+    struct cut_UnitStats *stats;
+    char *finished;
+};
+
+struct cut_Schedule {
+    int executed;
+    int failed;
+    int cached;
+    int failedUnits;
+    int stopped;
+    int tainted;
+    int isolated;
+    int64_t estimated;
+    int launched;
+    int inProcess;
+    int keptDirs;
+    int deferred;
+    int deferredTests;
+    int units;
+    int64_t launchTime;
+    int64_t unitTime;
+    int64_t started;
+    int running;
+    int printHead;
+    int statusLength;
+    int64_t statusShown;
+    int slotCount;
+    int threadCount;
+    struct cut_Slot *slots;
+    struct cut_TestProgress *tests;
+    struct cut_UnitQueue queue;
+    struct cut_UnitQueue threadQueue;
+};
+
+// stall shares are percents of the last 10 seconds, negative when they are not known
+struct cut_Pressure {
+    double cpu;
+    double memory;
+    double io;
+    double load;
+};
+
+struct cut_ScalingStep {
+    int64_t time;
+    int from;
+    int jobs;
+    struct cut_Pressure pressure;
+};
+
+struct cut_Scaling {
+    int jobs;
+    int lowest;
+    int highest;
+    int64_t sampled;
+    int size;
+    int capacity;
+    struct cut_ScalingStep *steps;
+};
+
+struct cut_Record {
+    char *name;
+    int subtest;
+};
+
+// the last durations of a unit give a percentile of its runtime
+#define CUT_HISTORY_SAMPLES 32
+
+struct cut_HistoryEntry {
+    struct cut_Record record;
+    int runs;
+    int64_t duration;
+    int64_t memory;
+    int failure;
+    int age;
+    uint64_t key;
+    int sampleCount;
+    int64_t samples[CUT_HISTORY_SAMPLES];
+};
+
+struct cut_History {
+    int size;
+    int capacity;
+    int64_t typical;
+    int64_t typicalMemory;
+    uint64_t *keys;
+    struct cut_HistoryEntry *entries;
+};
+
+struct cut_CacheEntry {
+    struct cut_Record record;
+    uint64_t key;
+    int failed;
+    int subtests;
+    int number;
+    char *title;
+};
+
+struct cut_Cache {
+    int size;
+    int capacity;
+    char *file;
+    uint64_t *keys;
+    struct cut_CacheEntry *entries;
+};
+
+struct cut_JournalEntry {
+    struct cut_Record record;
+    struct cut_UnitResult result;
+};
+
+struct cut_Journal {
+    int size;
+    int capacity;
+    int copy;
+    int resumedTests;
+    int resumedUnits;
+    int64_t synced;
+    FILE *file;
+    struct cut_JournalEntry *entries;
+};
+
+struct cut_LastRunEntry {
+    struct cut_Record record;
+    int failed;
+    int rerun;
+    int known;
+    int recorded;
+};
+
+struct cut_LastRun {
+    int size;
+    int capacity;
+    int failed;
+    char *file;
+    struct cut_LastRunEntry *entries;
+};
+
 struct cut_Arguments {
     int help;
     unsigned timeout;
@@ -195,6 +513,43 @@ struct cut_Arguments {
     char **match;
     const char *selfName;
     int shortPath;
+    int jobs;
+    int forkSubtests;
+    int spawn;
+    int pipe;
+    int stats;
+    int batch;
+    int unitCount;
+    struct cut_UnitId *units;
+    const char *history;
+    int shardIndex;
+    int shardCount;
+    const char *cache;
+    int noCache;
+    int failFast;
+    const char *lastRun;
+    int noLastRun;
+    int rerunFailed;
+    int repeat;
+    int untilFail;
+    int autoIsolate;
+    int threads;
+    int privateDir;
+    int keepPrivateDir;
+    char *privateRoot;
+    int sandbox;
+    int64_t memoryBudget;
+    int minJobs;
+    int maxJobs;
+    int64_t timeBudget;
+    unsigned timeoutFactor;
+    unsigned timeoutFloor;
+    unsigned timeoutCeiling;
+    const char *journal;
+    const char *resume;
+    int watch;
+    int watchDirCount;
+    const char **watchDirs;
 };
 
 enum cut_ReturnCodes {
@@ -215,6 +570,13 @@ enum cut_Colors {
 #  include "declarations.h"
 #  include "messages.h"
 #  include "execution.h"
+#  include "history.h"
+#  include "cache.h"
+#  include "rerun.h"
+#  include "journal.h"
+#  include "repeat.h"
+#  include "adaptive.h"
+#  include "scheduler.h"
 
 
 #  if defined(__linux__)
@@ -263,9 +625,42 @@ void cut_Register(cut_Instance instance, const char *name, const char *file, siz
     cut_unitTests.tests[cut_unitTests.size].name = name;
     cut_unitTests.tests[cut_unitTests.size].file = file;
     cut_unitTests.tests[cut_unitTests.size].line = line;
+    cut_unitTests.tests[cut_unitTests.size].timeout = 0;
+    cut_unitTests.tests[cut_unitTests.size].threadSafe = 0;
+    cut_unitTests.tests[cut_unitTests.size].resources = NULL;
     ++cut_unitTests.size;
 }
 
+void cut_RegisterTimeout(cut_Instance instance, unsigned timeout) {
+    for (int i = cut_unitTests.size - 1; i >= 0; --i) {
+        if (cut_unitTests.tests[i].instance == instance) {
+            cut_unitTests.tests[i].timeout = timeout;
+            return;
+        }
+    }
+    cut_FatalExit("cannot set timeout of unregistered test");
+}
+
+void cut_RegisterThreadSafe(cut_Instance instance) {
+    for (int i = cut_unitTests.size - 1; i >= 0; --i) {
+        if (cut_unitTests.tests[i].instance == instance) {
+            cut_unitTests.tests[i].threadSafe = 1;
+            return;
+        }
+    }
+    cut_FatalExit("cannot mark unregistered test as thread-safe");
+}
+
+void cut_RegisterResources(cut_Instance instance, const char **resources) {
+    for (int i = cut_unitTests.size - 1; i >= 0; --i) {
+        if (cut_unitTests.tests[i].instance == instance) {
+            cut_unitTests.tests[i].resources = resources;
+            return;
+        }
+    }
+    cut_FatalExit("cannot set resources of unregistered test");
+}
+
 void cut_RegisterGlobalTearUp(cut_GlobalTear instance) {
     if (cut_globalTearUp)
         cut_FatalExit("cannot overwrite tear up function");
@@ -278,6 +673,23 @@ void cut_RegisterGlobalTearDown(cut_GlobalTear instance) {
     cut_globalTearDown = instance;
 }
 
+void cut_RegisterGlobalSetupOnce(cut_GlobalTear instance) {
+    if (cut_globalSetupOnce)
+        cut_FatalExit("cannot overwrite setup once function");
+    cut_globalSetupOnce = instance;
+}
+
+// seconds, or milliseconds with suffix ms
+CUT_PRIVATE int cut_ParseMilliseconds(const char *text, unsigned *milliseconds) {
+    char unit[3] = {0,};
+    int parsed = sscanf(text, "%u%2s", milliseconds, unit);
+    if (parsed < 1 || (parsed == 2 && strcmp(unit, "ms")))
+        return 0;
+    if (parsed == 1)
+        *milliseconds *= 1000;
+    return 1;
+}
+
 CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
     static const char *help = "--help";
     static const char *timeout = "--timeout";
@@ -288,8 +700,42 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
     static const char *subtest = "--subtest";
     static const char *exactTest = "--test";
     static const char *shortPath = "--short-path";
+    static const char *jobs = "--jobs";
+    static const char *forkSubtests = "--fork-subtests";
+    static const char *spawn = "--spawn";
+    static const char *reportPipe = "--pipe";
+    static const char *stats = "--stats";
+    static const char *batch = "--batch";
+    static const char *units = "--units";
+    static const char *history = "--history";
+    static const char *noHistory = "--no-history";
+    static const char *shard = "--shard";
+    static const char *cache = "--cache";
+    static const char *noCache = "--no-cache";
+    static const char *failFast = "--fail-fast";
+    static const char *lastRun = "--last-run";
+    static const char *noLastRun = "--no-last-run";
+    static const char *rerunFailed = "--rerun-failed";
+    static const char *repeat = "--repeat";
+    static const char *untilFail = "--until-fail";
+    static const char *autoIsolate = "--auto-isolate";
+    static const char *threads = "--threads";
+    static const char *privateDir = "--private-dir";
+    static const char *keepPrivateDir = "--keep-private-dir";
+    static const char *privateRoot = "--private-root";
+    static const char *sandbox = "--sandbox";
+    static const char *memoryBudget = "--memory-budget";
+    static const char *adaptiveJobs = "--adaptive-jobs";
+    static const char *timeBudget = "--time-budget";
+    static const char *adaptiveTimeout = "--adaptive-timeout";
+    static const char *timeoutFloor = "--timeout-floor";
+    static const char *timeoutCeiling = "--timeout-ceiling";
+    static const char *journal = "--journal";
+    static const char *resume = "--resume";
+    static const char *watch = "--watch";
+    static const char *watchDir = "--watch-dir";
     cut_arguments.help = 0;
-    cut_arguments.timeout = CUT_TIMEOUT;
+    cut_arguments.timeout = CUT_TIMEOUT * 1000;
     cut_arguments.noFork = CUT_NO_FORK;
     cut_arguments.noColor = CUT_NO_COLOR;
     cut_arguments.output = NULL;
@@ -299,6 +745,43 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
     cut_arguments.subtestId = -1;
     cut_arguments.selfName = argv[0];
     cut_arguments.shortPath = -1;
+    cut_arguments.jobs = CUT_JOBS;
+    cut_arguments.forkSubtests = 0;
+    cut_arguments.spawn = 0;
+    cut_arguments.pipe = -1;
+    cut_arguments.stats = 0;
+    cut_arguments.batch = 1;
+    cut_arguments.unitCount = 0;
+    cut_arguments.units = NULL;
+    cut_arguments.history = CUT_HISTORY;
+    cut_arguments.shardIndex = 0;
+    cut_arguments.shardCount = 0;
+    cut_arguments.cache = CUT_CACHE;
+    cut_arguments.noCache = 0;
+    cut_arguments.failFast = 0;
+    cut_arguments.lastRun = CUT_LAST_RUN;
+    cut_arguments.noLastRun = 0;
+    cut_arguments.rerunFailed = 0;
+    cut_arguments.repeat = 0;
+    cut_arguments.untilFail = 0;
+    cut_arguments.autoIsolate = 0;
+    cut_arguments.threads = 0;
+    cut_arguments.privateDir = 0;
+    cut_arguments.keepPrivateDir = 0;
+    cut_arguments.privateRoot = NULL;
+    cut_arguments.sandbox = 0;
+    cut_arguments.memoryBudget = 0;
+    cut_arguments.minJobs = 0;
+    cut_arguments.maxJobs = 0;
+    cut_arguments.timeBudget = 0;
+    cut_arguments.timeoutFactor = 0;
+    cut_arguments.timeoutFloor = 100;
+    cut_arguments.timeoutCeiling = 600 * 1000;
+    cut_arguments.journal = NULL;
+    cut_arguments.resume = NULL;
+    cut_arguments.watch = 0;
+    cut_arguments.watchDirCount = 0;
+    cut_arguments.watchDirs = NULL;
 
     for (int i = 1; i < argc; ++i) {
         if (strncmp(argv[i], "--", 2)) {
@@ -311,10 +794,36 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
         }
         if (!strcmp(timeout, argv[i])) {
             ++i;
-            if (i >= argc || !sscanf(argv[i], "%u", &cut_arguments.timeout))
+            if (i >= argc || !cut_ParseMilliseconds(argv[i], &cut_arguments.timeout))
                 cut_ErrorExit("option %s requires numeric argument", timeout);
             continue;
         }
+        if (!strcmp(adaptiveTimeout, argv[i])) {
+            ++i;
+            if (i >= argc || !sscanf(argv[i], "%u", &cut_arguments.timeoutFactor) || !cut_arguments.timeoutFactor)
+                cut_ErrorExit("option %s requires positive numeric argument", adaptiveTimeout);
+            continue;
+        }
+        if (!strcmp(timeoutFloor, argv[i])) {
+            ++i;
+            if (i >= argc || !cut_ParseMilliseconds(argv[i], &cut_arguments.timeoutFloor))
+                cut_ErrorExit("option %s requires numeric argument", timeoutFloor);
+            continue;
+        }
+        if (!strcmp(timeoutCeiling, argv[i])) {
+            ++i;
+            if (i >= argc || !cut_ParseMilliseconds(argv[i], &cut_arguments.timeoutCeiling))
+                cut_ErrorExit("option %s requires numeric argument", timeoutCeiling);
+            continue;
+        }
+        if (!strcmp(timeBudget, argv[i])) {
+            ++i;
+            unsigned budget = 0;
+            if (i >= argc || !cut_ParseMilliseconds(argv[i], &budget) || !budget)
+                cut_ErrorExit("option %s requires positive numeric argument", timeBudget);
+            cut_arguments.timeBudget = (int64_t)budget * 1000;
+            continue;
+        }
         if (!strcmp(noFork, argv[i])) {
             cut_arguments.noFork = 1;
             continue;
@@ -323,6 +832,67 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
             cut_arguments.noFork = 0;
             continue;
         }
+        if (!strcmp(forkSubtests, argv[i])) {
+            cut_arguments.forkSubtests = 1;
+            continue;
+        }
+        if (!strcmp(spawn, argv[i])) {
+            cut_arguments.spawn = 1;
+            continue;
+        }
+        if (!strcmp(stats, argv[i])) {
+            cut_arguments.stats = 1;
+            continue;
+        }
+        if (!strcmp(noHistory, argv[i])) {
+            cut_arguments.history = NULL;
+            continue;
+        }
+        if (!strcmp(noCache, argv[i])) {
+            cut_arguments.noCache = 1;
+            continue;
+        }
+        if (!strcmp(noLastRun, argv[i])) {
+            cut_arguments.noLastRun = 1;
+            continue;
+        }
+        if (!strcmp(untilFail, argv[i])) {
+            cut_arguments.untilFail = 1;
+            continue;
+        }
+        if (!strcmp(autoIsolate, argv[i])) {
+            cut_arguments.autoIsolate = 1;
+            continue;
+        }
+        if (!strcmp(privateDir, argv[i])) {
+            cut_arguments.privateDir = 1;
+            continue;
+        }
+        if (!strcmp(keepPrivateDir, argv[i])) {
+            cut_arguments.privateDir = 1;
+            cut_arguments.keepPrivateDir = 1;
+            continue;
+        }
+        if (!strcmp(sandbox, argv[i])) {
+            cut_arguments.sandbox = 1;
+            continue;
+        }
+        if (!strcmp(rerunFailed, argv[i])) {
+            cut_arguments.rerunFailed = 1;
+            continue;
+        }
+        if (!strcmp(failFast, argv[i])) {
+            cut_arguments.failFast = 1;
+            continue;
+        }
+        if (!strncmp(failFast, argv[i], strlen(failFast)) && argv[i][strlen(failFast)] == '=') {
+            if (sscanf(argv[i] + strlen(failFast) + 1, "%d", &cut_arguments.failFast) != 1
+                || cut_arguments.failFast < 1)
+            {
+                cut_ErrorExit("option %s requires positive numeric argument", failFast);
+            }
+            continue;
+        }
         if (!strcmp(noColor, argv[i])) {
             cut_arguments.noColor = 1;
             continue;
@@ -338,6 +908,82 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
             }
             continue;
         }
+        if (!strcmp(history, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires string argument", history);
+            cut_arguments.history = argv[i];
+            continue;
+        }
+        if (!strcmp(journal, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires string argument", journal);
+            cut_arguments.journal = argv[i];
+            continue;
+        }
+        if (!strcmp(resume, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires string argument", resume);
+            cut_arguments.resume = argv[i];
+            continue;
+        }
+        if (!strcmp(watch, argv[i])) {
+            cut_arguments.watch = 1;
+            continue;
+        }
+        if (!strcmp(watchDir, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires string argument", watchDir);
+            cut_arguments.watchDirs = (const char **)realloc(cut_arguments.watchDirs,
+                sizeof(const char *) * (cut_arguments.watchDirCount + 1));
+            if (!cut_arguments.watchDirs)
+                cut_FatalExit("cannot allocate memory for list of watched directories");
+            cut_arguments.watchDirs[cut_arguments.watchDirCount++] = argv[i];
+            cut_arguments.watch = 1;
+            continue;
+        }
+        if (!strcmp(lastRun, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires string argument", lastRun);
+            cut_arguments.lastRun = argv[i];
+            continue;
+        }
+        if (!strcmp(cache, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires string argument", cache);
+            cut_arguments.cache = argv[i];
+            continue;
+        }
+        if (!strcmp(memoryBudget, argv[i])) {
+            ++i;
+            long long budget = 0;
+            char unit[2] = {0,};
+            int parsed = i < argc ? sscanf(argv[i], "%lld%1s", &budget, unit) : 0;
+            const char *units = "KMGT";
+            const char *scale = parsed == 2 ? strchr(units, toupper((unsigned char)*unit)) : NULL;
+            if (parsed < 1 || budget <= 0 || (parsed == 2 && !scale))
+                cut_ErrorExit("option %s requires size argument such as 512M or 16G", memoryBudget);
+            // the budget is kept in kilobytes as peaks of units are
+            cut_arguments.memoryBudget = scale ? budget : (budget + 1023) / 1024;
+            for (; scale && scale != units; --scale)
+                cut_arguments.memoryBudget *= 1024;
+            continue;
+        }
+        if (!strcmp(shard, argv[i])) {
+            ++i;
+            if (i >= argc
+                || sscanf(argv[i], "%d/%d", &cut_arguments.shardIndex, &cut_arguments.shardCount) != 2
+                || cut_arguments.shardIndex < 1 || cut_arguments.shardIndex > cut_arguments.shardCount)
+            {
+                cut_ErrorExit("option %s requires argument i/n where 1 <= i <= n", shard);
+            }
+            continue;
+        }
         if (!strcmp(exactTest, argv[i])) {
             ++i;
             if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.testId))
@@ -350,12 +996,69 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
                 cut_ErrorExit("option %s requires numeric argument", subtest);
             continue;
         }
+        if (!strcmp(reportPipe, argv[i])) {
+            ++i;
+            if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.pipe))
+                cut_ErrorExit("option %s requires numeric argument", reportPipe);
+            continue;
+        }
+        if (!strcmp(units, argv[i])) {
+            ++i;
+            if (i >= argc || !cut_ParseUnits(argv[i]))
+                cut_ErrorExit("option %s requires list of units", units);
+            continue;
+        }
+        if (!strcmp(privateRoot, argv[i])) {
+            ++i;
+            if (i >= argc)
+                cut_ErrorExit("option %s requires directory", privateRoot);
+            cut_arguments.privateRoot = argv[i];
+            continue;
+        }
         if (!strcmp(shortPath, argv[i])) {
             ++i;
             if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.shortPath))
                 cut_ErrorExit("option %s requires numeric argument", shortPath);
             continue;
         }
+        if (!strcmp(jobs, argv[i])) {
+            ++i;
+            if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.jobs))
+                cut_ErrorExit("option %s requires numeric argument", jobs);
+            if (cut_arguments.jobs <= 0)
+                cut_arguments.jobs = cut_ProcessorCount();
+            continue;
+        }
+        if (!strcmp(adaptiveJobs, argv[i])) {
+            ++i;
+            if (i >= argc || sscanf(argv[i], "%d:%d", &cut_arguments.minJobs, &cut_arguments.maxJobs) != 2)
+                cut_ErrorExit("option %s requires argument min:max", adaptiveJobs);
+            if (cut_arguments.maxJobs <= 0)
+                cut_arguments.maxJobs = cut_ProcessorCount();
+            if (cut_arguments.minJobs < 1 || cut_arguments.minJobs > cut_arguments.maxJobs)
+                cut_ErrorExit("option %s requires 1 <= min <= max", adaptiveJobs);
+            continue;
+        }
+        if (!strcmp(threads, argv[i])) {
+            ++i;
+            if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.threads))
+                cut_ErrorExit("option %s requires numeric argument", threads);
+            if (cut_arguments.threads <= 0)
+                cut_arguments.threads = cut_ProcessorCount();
+            continue;
+        }
+        if (!strcmp(repeat, argv[i])) {
+            ++i;
+            if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.repeat) || cut_arguments.repeat < 1)
+                cut_ErrorExit("option %s requires positive numeric argument", repeat);
+            continue;
+        }
+        if (!strcmp(batch, argv[i])) {
+            ++i;
+            if (i >= argc || !sscanf(argv[i], "%d", &cut_arguments.batch) || cut_arguments.batch < 1)
+                cut_ErrorExit("option %s requires positive numeric argument", batch);
+            continue;
+        }
         cut_ErrorExit("option %s is not recognized", argv[i]);
     }
     if (!cut_arguments.matchSize)
@@ -368,7 +1071,17 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
         if (!strncmp(argv[i], "--", 2)) {
             if (!strcmp(timeout, argv[i]) || !strcmp(output, argv[i])
              || !strcmp(subtest, argv[i]) || !strcmp(exactTest, argv[i])
-             || !strcmp(shortPath, argv[i]))
+             || !strcmp(shortPath, argv[i]) || !strcmp(jobs, argv[i])
+             || !strcmp(reportPipe, argv[i]) || !strcmp(batch, argv[i])
+             || !strcmp(units, argv[i]) || !strcmp(history, argv[i])
+             || !strcmp(shard, argv[i]) || !strcmp(cache, argv[i])
+             || !strcmp(lastRun, argv[i]) || !strcmp(repeat, argv[i])
+             || !strcmp(threads, argv[i]) || !strcmp(privateRoot, argv[i])
+             || !strcmp(memoryBudget, argv[i]) || !strcmp(adaptiveJobs, argv[i])
+             || !strcmp(timeBudget, argv[i]) || !strcmp(adaptiveTimeout, argv[i])
+             || !strcmp(timeoutFloor, argv[i]) || !strcmp(timeoutCeiling, argv[i])
+             || !strcmp(journal, argv[i]) || !strcmp(resume, argv[i])
+             || !strcmp(watchDir, argv[i]))
             {
                 ++i;
             }
@@ -378,6 +1091,28 @@ CUT_PRIVATE void cut_ParseArguments(int argc, char **argv) {
     }
 }
 
+CUT_PRIVATE int cut_ParseUnits(const char *list) {
+    int count = 1;
+    for (const char *c = list; *c; ++c)
+        count += *c == ',';
+    free(cut_arguments.units);
+    cut_arguments.units = (struct cut_UnitId *)calloc(count, sizeof(struct cut_UnitId));
+    if (!cut_arguments.units)
+        cut_ErrorExit("cannot allocate memory for list of units");
+    cut_arguments.unitCount = 0;
+    for (int i = 0; i < count; ++i) {
+        struct cut_UnitId *unit = &cut_arguments.units[i];
+        int consumed = 0;
+        if (sscanf(list, "%d:%d%n", &unit->testId, &unit->subtest, &consumed) != 2)
+            return 0;
+        list += consumed;
+        if (*list && *list++ != ',')
+            return 0;
+        ++cut_arguments.unitCount;
+    }
+    return !*list;
+}
+
 CUT_PRIVATE void cut_CleanInfo(struct cut_Info *info) {
     while (info) {
         struct cut_Info *current = info;
@@ -404,15 +1139,71 @@ CUT_PRIVATE int cut_Help() {
     "\n"
     "Options:\n"
     "\t--help            Print out this help.\n"
-    "\t--timeout <N>     Set timeout of each test in seconds. 0 for no timeout.\n"
-    "\t--no-fork         Disable forking. Timeout is turned off.\n"
+    "\t--timeout <N>     Set timeout of each test in seconds (or milliseconds\n"
+    "\t                  with suffix ms). 0 for no timeout.\n"
+    "\t--no-fork         Disable forking. Crashes and timeouts are recovered.\n"
     "\t--fork            Force forking. Usefull during debugging with fork enabled.\n"
     "\t--no-color        Turn off colors.\n"
     "\t--output <file>   Redirect output to the file.\n"
     "\t--short-path <N>  Make filenames in the output shorter.\n"
+    "\t--jobs <N>        Run N units in parallel. 0 for number of online CPUs.\n"
+    "\t--adaptive-jobs <min:max>\n"
+    "\t                  Run between min and max units in parallel as the load\n"
+    "\t                  of the machine allows. 0 as max for number of online CPUs.\n"
+    "\t--threads <N>     Run units of thread-safe tests on N threads of the runner.\n"
+    "\t                  0 for number of online CPUs.\n"
+    "\t--fork-subtests   Run a test once and fork it at each subtest.\n"
+    "\t--spawn           Start units by re-executing the binary instead of fork.\n"
+    "\t--auto-isolate    Run units in the process of the runner and re-run those\n"
+    "\t                  which crash, time out or damage it in new processes.\n"
+    "\t--stats           Print statistics about launching of units.\n"
+    "\t--batch <N>       Run up to N units one after another in a single process.\n"
+    "\t--history <file>  Record durations of units to the file and run the longest\n"
+    "\t                  units first next time.\n"
+    "\t--no-history      Do not use any history file.\n"
+    "\t--adaptive-timeout <N>\n"
+    "\t                  Time out units after N times the 99th percentile of their\n"
+    "\t                  durations in the history.\n"
+    "\t--timeout-floor <N>\n"
+    "\t                  Lower limit of adaptive timeouts (default 100ms).\n"
+    "\t--timeout-ceiling <N>\n"
+    "\t                  Upper limit of adaptive timeouts (default 600 s).\n"
+    "\t--time-budget <N> Start only units expected to end within N seconds and\n"
+    "\t                  run the likely failing, fast ones first.\n"
+    "\t--memory-budget <size>\n"
+    "\t                  Start units only while the sum of their peak memory\n"
+    "\t                  recorded in the history stays within size (e.g. 16G).\n"
+    "\t--shard <i/n>     Run only the i-th of n disjoint parts of the tests.\n"
+    "\t--cache <dir>     Keep results of passed tests in the directory and skip\n"
+    "\t                  tests whose code did not change since then.\n"
+    "\t--no-cache        Run all tests, the cache is only refreshed.\n"
+    "\t--fail-fast[=N]   Stop the run after N failed units (1 by default).\n"
+    "\t--last-run <file> Record outcomes of units to the file (default is\n"
+    "\t                  the name of the binary with suffix .last-run).\n"
+    "\t--no-last-run     Do not read or write the record of the last run.\n"
+    "\t--rerun-failed    Run only units which failed according to the record.\n"
+    "\t--journal <file>  Append the result of each finished unit to the file.\n"
+    "\t--resume <file>   Take results of units from the journal instead of running\n"
+    "\t                  them again and go on appending to it.\n"
+    "\t--repeat <N>      Run each unit N times and print a flakiness report.\n"
+    "\t--until-fail      Repeat each unit until it fails (at most N times with\n"
+    "\t                  --repeat), other units go on.\n"
+    "\t--private-dir     Run each unit in a new directory under $CUT_TMPDIR\n"
+    "\t                  (or /dev/shm) which is removed afterwards.\n"
+    "\t--keep-private-dir\n"
+    "\t                  The same, but keep directories of failed units.\n"
+    "\t--sandbox         Run each unit in new user, mount, network and pid\n"
+    "\t                  namespaces; processes left by the unit are killed.\n"
+    "\t--watch           Run the tests again whenever the binary is rebuilt, those\n"
+    "\t                  which failed last time first.\n"
+    "\t--watch-dir <dir> Run the tests again also when files in dir change.\n"
     "Hidden options (for internal purposes only):\n"
     "\t--test <N>        Run test of index N.\n"
     "\t--subtest <N>     Run subtest of index N (for all tests).\n"
+    "\t--pipe <N>        Report results of the unit to the file descriptor N.\n"
+    "\t--units <list>    Run units given as test:subtest,... in a row.\n"
+    "\t--private-root <dir>\n"
+    "\t                  Create private directories of units in dir.\n"
     "\n"
     "Test names - any other parameter is accepted as a filter of test names. "
     "In case there is at least one filter parameter, a test is executed only if "
@@ -9,8 +9,12 @@
 CUT_NORETURN int cut_FatalExit(const char *reason);
 CUT_NORETURN int cut_ErrorExit(const char *reason, ...);
 void cut_Register(cut_Instance instance, const char *name, const char *file, size_t line);
+void cut_RegisterTimeout(cut_Instance instance, unsigned timeout);
+void cut_RegisterThreadSafe(cut_Instance instance);
+void cut_RegisterResources(cut_Instance instance, const char **resources);
 void cut_RegisterGlobalTearUp(cut_GlobalTear instance);
 void cut_RegisterGlobalTearDown(cut_GlobalTear instance);
+void cut_RegisterGlobalSetupOnce(cut_GlobalTear instance);
 CUT_PRIVATE int cut_Help();
 CUT_PRIVATE int cut_SendMessage(const struct cut_Fragment *message);
 CUT_PRIVATE int cut_ReadMessage(struct cut_Fragment *message);
@@ -25,8 +29,14 @@ void cut_Check(const char *text, const char *file, size_t line);
 CUT_PRIVATE void cut_StopException(const char *type, const char *text);
 #  endif
 CUT_PRIVATE void cut_ExceptionBypass(int testId, int subtest);
+CUT_PRIVATE void cut_RunBatch(const struct cut_UnitId *units, int count);
 CUT_PRIVATE void cut_Timeouted();
 void cut_Subtest(int number, const char *name);
+int cut_Branch(int first, int last, int *current);
+CUT_PRIVATE void cut_SendBranch(int subtest, int pid);
+CUT_PRIVATE void cut_SendStatus(int returnCode, int signal);
+CUT_PRIVATE void cut_SendUnit(int testId, int subtest);
+CUT_PRIVATE int cut_ProcessMessage(struct cut_Fragment *message, struct cut_UnitResult *result);
 CUT_PRIVATE void *cut_PipeReader(struct cut_UnitResult *result);
 CUT_PRIVATE int cut_SetSubtestName(struct cut_UnitResult *result, int number, const char *name);
 CUT_PRIVATE int cut_AddInfo(struct cut_Info **info,
@@ -35,7 +45,9 @@ CUT_PRIVATE int cut_SetFailResult(struct cut_UnitResult *result,
     size_t line, const char *file, const char *text);
 CUT_PRIVATE int cut_SetExceptionResult(struct cut_UnitResult *result,
     const char *type, const char *text);
+CUT_PRIVATE int cut_ParseMilliseconds(const char *text, unsigned *milliseconds);
 CUT_PRIVATE void cut_ParseArguments(int argc, char **argv);
+CUT_PRIVATE int cut_ParseUnits(const char *list);
 CUT_PRIVATE int cut_SkipUnit(int testId);
 CUT_PRIVATE const char *cut_GetStatus(const struct cut_UnitResult *result, enum cut_Colors *color);
 CUT_PRIVATE const char *cut_ShortPath(const char *path);
@@ -45,6 +57,88 @@ CUT_PRIVATE void cut_CleanMemory(struct cut_UnitResult *result);
 CUT_PRIVATE int cut_TestComparator(const void *lhs, const void *rhs);
 CUT_PRIVATE int cut_Runner(int argc, char **argv);
 CUT_PRIVATE void cut_RunUnitForkless(int testId, int subtest, struct cut_UnitResult *result);
+CUT_PRIVATE const char *cut_EmergencyLog(int pid);
+CUT_PRIVATE void cut_ReadEmergencyLog(int pid, struct cut_UnitResult *result);
+CUT_PRIVATE void cut_PrivateDir(char *path, size_t size, int testId, int subtest, int pid, int index);
+CUT_PRIVATE void cut_LeavePrivateDir(const struct cut_Slot *slot, const struct cut_UnitResult *result);
+CUT_PRIVATE void cut_RemovePrivateRoot();
+CUT_PRIVATE void cut_LoadHistory();
+CUT_PRIVATE void cut_SaveHistory();
+CUT_PRIVATE void cut_RecordDuration(int testId, int subtest, int64_t duration);
+CUT_PRIVATE int64_t cut_EstimateDuration(int testId, int subtest);
+CUT_PRIVATE void cut_RecordMemory(int testId, int subtest, int64_t memory);
+CUT_PRIVATE void cut_RecordFailure(int testId, int subtest, int failed);
+CUT_PRIVATE int64_t cut_UnitValue(int testId, int subtest);
+CUT_PRIVATE void cut_RecordSample(int testId, int subtest, const struct cut_UnitResult *result);
+CUT_PRIVATE unsigned cut_AdaptiveTimeout(int testId, int subtest);
+CUT_PRIVATE int64_t cut_EstimateMemory(int testId, int subtest);
+CUT_PRIVATE int64_t cut_UnitPriority(int testId, int subtest);
+CUT_PRIVATE void cut_CleanHistory();
+CUT_PRIVATE void cut_LoadCache();
+CUT_PRIVATE void cut_SaveCache();
+CUT_PRIVATE int cut_CachedTest(int testId);
+CUT_PRIVATE void cut_RecordCache(int testId, int subtest, const struct cut_UnitResult *result);
+CUT_PRIVATE void cut_CleanCache();
+CUT_PRIVATE void cut_LoadLastRun();
+CUT_PRIVATE void cut_SaveLastRun();
+CUT_PRIVATE int cut_RerunUnit(int testId, int subtest);
+CUT_PRIVATE int cut_RerunTest(int testId);
+CUT_PRIVATE void cut_EnqueueRerun(int testId);
+CUT_PRIVATE void cut_RecordOutcome(int testId, int subtest, const struct cut_UnitResult *result);
+CUT_PRIVATE void cut_FailedFirst(struct cut_UnitQueue *queue);
+CUT_PRIVATE void cut_PrintChanges();
+CUT_PRIVATE void cut_CleanLastRun();
+CUT_PRIVATE void cut_OpenJournal();
+CUT_PRIVATE int cut_ResumedTest(int testId);
+CUT_PRIVATE void cut_RecordJournal(int testId, int subtest, const struct cut_UnitResult *result);
+CUT_PRIVATE void cut_CloseJournal();
+CUT_PRIVATE void cut_CleanJournal();
+CUT_PRIVATE int cut_RepeatCopies(int testId, int subtest);
+CUT_PRIVATE int cut_RepeatUnit(int testId, int subtest, struct cut_UnitResult *result);
+CUT_PRIVATE void cut_FlushRepeats();
+CUT_PRIVATE void cut_PrintRepeats();
+CUT_PRIVATE void cut_CleanStats(struct cut_UnitStats *stats);
+CUT_PRIVATE void cut_StartScaling();
+CUT_PRIVATE void cut_AdaptJobs();
+CUT_PRIVATE int cut_JobsAvailable(const struct cut_Slot *slot);
+CUT_PRIVATE int cut_ScalingTimeout();
+CUT_PRIVATE void cut_PrintScaling();
+CUT_PRIVATE void cut_CleanScaling();
+CUT_PRIVATE void cut_PushUnit(int testId, int subtest, int front, int isolated);
+CUT_PRIVATE void cut_EnqueueUnit(int testId, int subtest, int front, int isolated);
+CUT_PRIVATE int cut_ThreadTest(int testId);
+CUT_PRIVATE void cut_TakeUnit(struct cut_UnitQueue *queue, int position, struct cut_UnitId *unit);
+CUT_PRIVATE int cut_SharedResource(int lhs, int rhs);
+CUT_PRIVATE int cut_ResourceBusy(int testId);
+CUT_PRIVATE int cut_MemoryFits(const struct cut_Slot *slot, int64_t memory);
+CUT_PRIVATE int cut_OverBudget(const struct cut_Slot *slot, int testId, int subtest);
+CUT_PRIVATE void cut_DeferUnit(const struct cut_UnitId *unit);
+CUT_PRIVATE struct cut_UnitQueue *cut_SlotQueue(const struct cut_Slot *slot);
+CUT_PRIVATE void cut_DequeueBatch(struct cut_Slot *slot);
+CUT_PRIVATE void cut_ReserveResults(struct cut_TestProgress *progress, int subtests);
+CUT_PRIVATE void cut_DiscoverSubtests(int testId, int subtests);
+CUT_PRIVATE void cut_AdvanceBatch(struct cut_Slot *slot, int testId, int subtest);
+CUT_PRIVATE void cut_SlotFeed(struct cut_Slot *slot, const char *data, size_t length);
+CUT_PRIVATE unsigned cut_UnitTimeout(int testId, int subtest);
+CUT_PRIVATE int cut_WaitTimeout();
+CUT_PRIVATE void cut_CheckDeadlines();
+CUT_PRIVATE void cut_StoreResult(int testId, int subtest, struct cut_UnitResult *result);
+CUT_PRIVATE int cut_RunsInProcess();
+CUT_PRIVATE void cut_IsolateUnit(struct cut_Slot *slot);
+CUT_PRIVATE void cut_StartUnit(struct cut_Slot *slot);
+CUT_PRIVATE void cut_FinishUnit(struct cut_Slot *slot);
+CUT_PRIVATE void cut_StopSchedule();
+CUT_PRIVATE uint64_t cut_HashBytes(uint64_t hash, const void *data, size_t length);
+CUT_PRIVATE uint64_t cut_HashMix(uint64_t hash);
+CUT_PRIVATE uint64_t cut_Hash(const char *text, uint64_t seed);
+CUT_PRIVATE void cut_SelectShard();
+CUT_PRIVATE int cut_StartedTest(const struct cut_TestProgress *progress);
+CUT_PRIVATE void cut_ClearStatus();
+CUT_PRIVATE void cut_PrintStatus();
+CUT_PRIVATE void cut_PrintProgress();
+CUT_PRIVATE void cut_RunSchedule();
+CUT_PRIVATE void cut_PrintStatistics();
+CUT_PRIVATE void cut_CleanSchedule();
 
 // platform specific functions
 CUT_PRIVATE int64_t cut_Read(int fd, char *destination, size_t bytes);
@@ -52,7 +146,26 @@ CUT_PRIVATE int64_t cut_Write(int fd, const char *source, size_t bytes);
 CUT_PRIVATE void cut_RedirectIO();
 CUT_PRIVATE void cut_ResumeIO();
 CUT_PRIVATE int cut_PreRun();
-CUT_PRIVATE void cut_RunUnit(int testId, int subtest, struct cut_UnitResult *result);
+CUT_PRIVATE int cut_ProcessorCount();
+CUT_PRIVATE int cut_ReadPressure(struct cut_Pressure *pressure);
+CUT_PRIVATE int64_t cut_Now();
+CUT_PRIVATE void cut_KillUnit(int pid);
+CUT_PRIVATE void cut_StartZygote();
+CUT_PRIVATE void cut_StopZygote();
+CUT_PRIVATE void cut_LaunchUnit(struct cut_Slot *slot);
+CUT_PRIVATE void cut_LaunchThread(struct cut_Slot *slot);
+CUT_PRIVATE void cut_WaitForUnits(struct cut_Slot *slots, int count, int timeout);
+CUT_PRIVATE void cut_GuardUnit(int testId, int subtest);
+CUT_PRIVATE void cut_ReleaseUnit();
+CUT_PRIVATE void cut_SyncFile(FILE *file);
+CUT_PRIVATE void cut_Restart(char **argv);
+CUT_PRIVATE void cut_RearmUnit();
+CUT_PRIVATE uint64_t cut_ProcessFingerprint();
+CUT_PRIVATE char *cut_MakePrivateRoot();
+CUT_PRIVATE void cut_EnterPrivateDir(int testId, int subtest, int index);
+CUT_PRIVATE void cut_RemoveTree(const char *path);
+CUT_PRIVATE int cut_HashTests(uint64_t *keys);
+CUT_PRIVATE int cut_MakeDirectory(const char *path);
 int cut_File(FILE *file, const char *content);
 CUT_PRIVATE int cut_IsDebugger();
 CUT_PRIVATE int cut_IsTerminalOutput();
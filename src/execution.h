@@ -13,15 +13,26 @@
 #  include <string>
 
 CUT_PRIVATE void cut_ExceptionBypass(int testId, int subtest) {
-    cut_RedirectIO();
-    if (setjmp(cut_executionPoint))
+    // the result is sent once the teardown is over, it may still fail the unit
+    volatile int passed = 0;
+    volatile int subtests = 0;
+    // standard outputs are shared by all threads, units on threads print straight to them
+    if (!cut_unitThread)
+        cut_RedirectIO();
+    if (CUT_SET_JUMP(cut_executionPoint))
         goto cleanup;
+    cut_heartbeatDone = 0;
+    cut_heartbeatSent = 0;
+    // without a process of its own, the unit has to survive its crash and timeout here
+    if (cut_inProcess)
+        cut_GuardUnit(testId, subtest);
     if (cut_globalTearUp)
         cut_globalTearUp();
     try {
         int counter = 0;
         cut_unitTests.tests[testId].instance(&counter, subtest);
-        cut_SendOK(counter);
+        subtests = counter;
+        passed = 1;
     } catch (const std::exception &e) {
         std::string name = typeid(e).name();
         cut_StopException(name.c_str(), e.what() ? e.what() : "(no reason)");
@@ -29,29 +40,72 @@ CUT_PRIVATE void cut_ExceptionBypass(int testId, int subtest) {
         cut_StopException("unknown type", "(empty message)");
     }
 cleanup:
-    if (cut_globalTearDown)
+    // a crash or a hang of the teardown is reported against the unit, the guard stays until it ends
+    if (cut_globalTearDown && !CUT_SET_JUMP(cut_executionPoint)) {
+        cut_RearmUnit();
         cut_globalTearDown();
-    cut_ResumeIO();
+    }
+    if (cut_inProcess)
+        cut_ReleaseUnit();
+    if (cut_crashSignal) {
+        cut_SendStatus(0, cut_crashSignal);
+        cut_crashSignal = 0;
+    } else if (passed) {
+        cut_SendOK(subtests);
+    }
+    if (!cut_unitThread)
+        cut_ResumeIO();
 }
 
 extern "C" {
 # else
 CUT_PRIVATE void cut_ExceptionBypass(int testId, int subtest) {
-    cut_RedirectIO();
-    if (setjmp(cut_executionPoint))
+    // the result is sent once the teardown is over, it may still fail the unit
+    volatile int passed = 0;
+    volatile int subtests = 0;
+    // standard outputs are shared by all threads, units on threads print straight to them
+    if (!cut_unitThread)
+        cut_RedirectIO();
+    if (CUT_SET_JUMP(cut_executionPoint))
         goto cleanup;
+    cut_heartbeatDone = 0;
+    cut_heartbeatSent = 0;
+    // without a process of its own, the unit has to survive its crash and timeout here
+    if (cut_inProcess)
+        cut_GuardUnit(testId, subtest);
     if (cut_globalTearUp)
         cut_globalTearUp();
     int counter = 0;
     cut_unitTests.tests[testId].instance(&counter, subtest);
-    cut_SendOK(counter);
+    subtests = counter;
+    passed = 1;
 cleanup:
-    if (cut_globalTearDown)
+    // a crash or a hang of the teardown is reported against the unit, the guard stays until it ends
+    if (cut_globalTearDown && !CUT_SET_JUMP(cut_executionPoint)) {
+        cut_RearmUnit();
         cut_globalTearDown();
-    cut_ResumeIO();
+    }
+    if (cut_inProcess)
+        cut_ReleaseUnit();
+    if (cut_crashSignal) {
+        cut_SendStatus(0, cut_crashSignal);
+        cut_crashSignal = 0;
+    } else if (passed) {
+        cut_SendOK(subtests);
+    }
+    if (!cut_unitThread)
+        cut_ResumeIO();
 }
 # endif
 
+CUT_PRIVATE void cut_RunBatch(const struct cut_UnitId *units, int count) {
+    // a forked subtest finishes its own unit only
+    for (int i = 0; i < count && !cut_branched; ++i) {
+        cut_SendUnit(units[i].testId, units[i].subtest);
+        cut_EnterPrivateDir(units[i].testId, units[i].subtest, i);
+        cut_ExceptionBypass(units[i].testId, units[i].subtest);
+    }
+}
 
 CUT_PRIVATE int cut_SkipUnit(int testId) {
     if (cut_arguments.testId >= 0)
@@ -70,6 +124,9 @@ CUT_PRIVATE const char *cut_GetStatus(const struct cut_UnitResult *result, enum
     static const char *ok = "OK";
     static const char *fail = "FAIL";
     static const char *internalFail = "INTERNAL ERROR";
+    static const char *cached = "CACHED";
+    static const char *cancelled = "CANCELLED";
+    static const char *deferred = "DEFERRED";
 
     if (result->returnCode == cut_FATAL_EXIT) {
         *color = cut_YELLOW_COLOR;
@@ -79,8 +136,16 @@ CUT_PRIVATE const char *cut_GetStatus(const struct cut_UnitResult *result, enum
         *color = cut_RED_COLOR;
         return fail;
     }
+    if (result->cancelled) {
+        *color = cut_YELLOW_COLOR;
+        return cancelled;
+    }
+    if (result->deferred) {
+        *color = cut_YELLOW_COLOR;
+        return deferred;
+    }
     *color = cut_GREEN_COLOR;
-    return ok;
+    return result->cached ? cached : ok;
 }
 
 CUT_PRIVATE const char *cut_ShortPath(const char *path) {
@@ -168,6 +233,10 @@ CUT_PRIVATE void cut_PrintResult(int base, int subtest, int subtests, const stru
         if (result->number)
             lastPosition -= fprintf(cut_output, " #%d", result->number);
         indent = longIndent;
+    } else if (subtest) {
+        // a subtest which has never run does not know its name
+        lastPosition -= fprintf(cut_output, "%s#%d", indent, subtest);
+        indent = longIndent;
     } else {
         lastPosition -= base;
     }
@@ -191,8 +260,10 @@ CUT_PRIVATE void cut_PrintResult(int base, int subtest, int subtests, const stru
             fprintf(cut_output, "%scheck '%s' (%s:%d)\n", indent, current->message,
                     cut_ShortPath(current->file), current->line);
         }
-        if (result->timeouted)
-            fprintf(cut_output, "%stimeouted (%d s)\n", indent, cut_arguments.timeout);
+        if (result->timeouted && result->timeout % 1000)
+            fprintf(cut_output, "%stimeouted (%u ms)\n", indent, result->timeout);
+        else if (result->timeouted)
+            fprintf(cut_output, "%stimeouted (%u s)\n", indent, result->timeout / 1000);
         else if (result->signal)
             fprintf(cut_output, "%ssignal: %s\n", indent, cut_Signal(result->signal));
         if (result->returnCode)
@@ -219,11 +290,12 @@ CUT_PRIVATE void cut_PrintResult(int base, int subtest, int subtests, const stru
 }
 
 CUT_PRIVATE void cut_RunUnitForkless(int testId, int subtest, struct cut_UnitResult *result) {
+    // the unit behaves as with --no-fork whatever the mode of the runner is
+    cut_inProcess = 1;
     cut_ExceptionBypass(testId, subtest);
     cut_PipeReader(result);
     cut_ResetLocalMessage();
-    result->returnCode = 0;
-    result->signal = 0;
+    cut_inProcess = 0;
 }
 
 CUT_PRIVATE int cut_TestComparator(const void *_lhs, const void *_rhs) {
@@ -240,12 +312,32 @@ CUT_PRIVATE int cut_TestComparator(const void *_lhs, const void *_rhs) {
 CUT_PRIVATE int cut_Runner(int argc, char **argv) {
     cut_output = stdout;
     cut_ParseArguments(argc, argv);
-
-    void (*unitRunner)(int, int, struct cut_UnitResult *) =
-        cut_arguments.noFork ? cut_RunUnitForkless : cut_RunUnit;
-
-    int failed = 0;
-    int executed = 0;
+    if (cut_arguments.untilFail && !cut_arguments.repeat)
+        cut_arguments.repeat = INT_MAX;
+    // failed and repeated subtests are run on their own, not forked from the whole test
+    if (cut_arguments.noFork || cut_arguments.rerunFailed || cut_arguments.repeat
+        || (cut_arguments.subtestId >= 0 && cut_arguments.pipe < 0))
+    {
+        cut_arguments.forkSubtests = 0;
+    }
+    if (cut_arguments.noFork)
+        cut_arguments.autoIsolate = 0;
+    // subtests of a unit run in the runner cannot be forked from it
+    if (cut_arguments.autoIsolate)
+        cut_arguments.forkSubtests = 0;
+    if (cut_arguments.noFork)
+        cut_arguments.batch = 1;
+    if (cut_arguments.noFork)
+        cut_arguments.minJobs = 0;
+    if (cut_arguments.minJobs)
+        cut_arguments.jobs = cut_arguments.maxJobs;
+    // a unit run by the runner itself cannot be put into namespaces of its own
+    if (cut_arguments.noFork)
+        cut_arguments.sandbox = 0;
+    if (cut_arguments.sandbox) {
+        cut_arguments.autoIsolate = 0;
+        cut_arguments.threads = 0;
+    }
 
     qsort(cut_unitTests.tests, cut_unitTests.size, sizeof(struct cut_UnitTest), cut_TestComparator);
 
@@ -259,54 +351,26 @@ CUT_PRIVATE int cut_Runner(int argc, char **argv) {
     }
 
     if (cut_arguments.help) {
-        failed = cut_Help();
+        cut_Help();
         goto cleanup;
     }
 
-    for (int i = 0; i < cut_unitTests.size; ++i) {
-        if (cut_SkipUnit(i))
-            continue;
-        ++executed;
-        int base = fprintf(cut_output, "[%3i] %s", executed, cut_unitTests.tests[i].name);
-        fflush(cut_output);
-        int subtests = 0;
-        if (cut_arguments.subtestId > 0)
-            subtests = cut_arguments.subtestId;
-        int subtestFailure = 0;
-        for (int subtest = 0; subtest <= subtests; ++subtest) {
-            if (cut_arguments.subtestId >= 0 && cut_arguments.subtestId != subtest)
-                continue;
-            struct cut_UnitResult result;
-            memset(&result, 0, sizeof(result));
-            unitRunner(i, subtest, &result);
-            if (result.failed)
-                ++subtestFailure;
-            FILE *emergencyLog = fopen(cut_emergencyLog, "r");
-            if (emergencyLog) {
-                char buffer[512] = {0,};
-                fread(buffer, 512, 1, emergencyLog);
-                if (*buffer) {
-                    result.statement = (char *)malloc(strlen(buffer) + 1);
-                    strcpy(result.statement, buffer);
-                }
-                fclose(emergencyLog);
-                remove(cut_emergencyLog);
-            }
-            if (result.subtests > subtests)
-                subtests = result.subtests;
-            cut_PrintResult(base, subtest, subtests, &result);
-            cut_CleanMemory(&result);
-        }
-        if (subtests > 1) {
-            base = fprintf(cut_output, "[%3i] %s (overall)", executed, cut_unitTests.tests[i].name);
-            struct cut_UnitResult result;
-            memset(&result, 0, sizeof(result));
-            result.failed = subtestFailure;
-            cut_PrintResult(base, 0, -1, &result);
-        }
-        if (subtestFailure)
-            ++failed;
-    }
+    cut_LoadHistory();
+    cut_LoadCache();
+    cut_LoadLastRun();
+    cut_OpenJournal();
+    if (cut_arguments.privateDir)
+        cut_arguments.privateRoot = cut_MakePrivateRoot();
+    cut_StartZygote();
+    cut_RunSchedule();
+    cut_CloseJournal();
+    cut_StopZygote();
+    cut_RemovePrivateRoot();
+    cut_SaveHistory();
+    cut_SaveCache();
+    cut_SaveLastRun();
+    cut_PrintRepeats();
+
     fprintf(cut_output,
             "\nSummary:\n"
             "  tests:     %3i\n"
@@ -314,15 +378,58 @@ CUT_PRIVATE int cut_Runner(int argc, char **argv) {
             "  skipped:   %3i\n"
             "  failed:    %3i\n",
             cut_unitTests.size,
-            executed - failed,
-            cut_unitTests.size - executed,
-            failed);
+            cut_schedule.executed - cut_schedule.failed - cut_schedule.cached - cut_schedule.deferredTests,
+            cut_unitTests.size - cut_schedule.executed,
+            cut_schedule.failed);
+    if (cut_cache.keys)
+        fprintf(cut_output, "  cached:    %3i\n", cut_schedule.cached);
+    if (cut_arguments.resume)
+        fprintf(cut_output, "  resumed:   %3i (%i unit%s from %s)\n", cut_journal.resumedTests,
+                cut_journal.resumedUnits, cut_journal.resumedUnits == 1 ? "" : "s", cut_arguments.resume);
+    if (cut_schedule.keptDirs)
+        fprintf(cut_output, "  kept:      %3i private director%s in %s\n", cut_schedule.keptDirs,
+                cut_schedule.keptDirs == 1 ? "y" : "ies", cut_arguments.privateRoot);
+    if (cut_arguments.timeBudget)
+        fprintf(cut_output, "  deferred:  %3i (%i unit%s over the time budget of %.3f s)\n",
+                cut_schedule.deferredTests, cut_schedule.deferred, cut_schedule.deferred == 1 ? "" : "s",
+                cut_arguments.timeBudget / 1000000.0);
+    if (cut_schedule.stopped)
+        fprintf(cut_output, "  stopped:   after %i failed unit%s\n",
+                cut_schedule.failedUnits, cut_schedule.failedUnits == 1 ? "" : "s");
+    if (cut_arguments.shardCount && cut_arguments.history)
+        fprintf(cut_output, "  shard:     %i/%i (%i tests, expected %.3f s)\n",
+                cut_arguments.shardIndex, cut_arguments.shardCount,
+                cut_schedule.executed, cut_schedule.estimated / 1000000.0);
+    else if (cut_arguments.shardCount)
+        fprintf(cut_output, "  shard:     %i/%i (%i tests)\n",
+                cut_arguments.shardIndex, cut_arguments.shardCount, cut_schedule.executed);
+    cut_PrintScaling();
+    if (cut_arguments.stats)
+        cut_PrintStatistics();
+    if (cut_arguments.watch) {
+        cut_PrintChanges();
+        fprintf(cut_output, "\nWaiting for changes...\n");
+    }
     if (cut_arguments.output)
         fclose(cut_output);
+    // the next run is done by the rebuilt binary, it starts from scratch
+    if (cut_arguments.watch) {
+        fflush(stdout);
+        cut_Restart(argv);
+    }
 cleanup:
+    if (cut_arguments.privateDir)
+        free(cut_arguments.privateRoot);
+    cut_CleanSchedule();
+    cut_CleanHistory();
+    cut_CleanCache();
+    cut_CleanLastRun();
+    cut_CleanJournal();
+    cut_CleanScaling();
     free(cut_unitTests.tests);
     free(cut_arguments.match);
-    return failed;
+    free(cut_arguments.units);
+    return cut_schedule.failed;
 }
 
 #endif // CUT_EXECUTION_H
@@ -6,23 +6,42 @@
 #endif
 
 #define CUT_MAX_LOCAL_MESSAGE_LENGTH 4096
+#define CUT_HEARTBEAT_PERIOD 10000
+#define CUT_STATUS_PERIOD 100000
+#define CUT_JOURNAL_SYNC_PERIOD 1000000
+#define CUT_WATCH_SETTLE 50
 
 CUT_PRIVATE struct cut_Arguments cut_arguments;
 CUT_PRIVATE struct cut_UnitTestArray cut_unitTests = {0, 0, NULL};
 CUT_PRIVATE FILE *cut_output = NULL;
 CUT_PRIVATE int cut_outputsRedirected = 0;
-CUT_PRIVATE int cut_pipeWrite = 0;
+// a unit run on a thread of the runner has its own channel, jump point and messages
+CUT_PRIVATE CUT_THREAD_LOCAL int cut_pipeWrite = 0;
 CUT_PRIVATE int cut_pipeRead = 0;
 CUT_PRIVATE int cut_originalStdOut = 0;
 CUT_PRIVATE int cut_originalStdErr = 0;
 CUT_PRIVATE FILE *cut_stdout = NULL;
 CUT_PRIVATE FILE *cut_stderr = NULL;
-CUT_PRIVATE jmp_buf cut_executionPoint;
+CUT_PRIVATE CUT_THREAD_LOCAL CUT_JUMP_BUFFER cut_executionPoint;
+CUT_PRIVATE CUT_THREAD_LOCAL volatile sig_atomic_t cut_crashSignal = 0;
 CUT_PRIVATE const char *cut_emergencyLog = "cut.log";
-CUT_PRIVATE int cut_localMessageSize = 0;
-CUT_PRIVATE char cut_localMessage[CUT_MAX_LOCAL_MESSAGE_LENGTH];
-CUT_PRIVATE char *cut_localMessageCursor = NULL;
+CUT_PRIVATE CUT_THREAD_LOCAL int cut_localMessageSize = 0;
+CUT_PRIVATE CUT_THREAD_LOCAL char cut_localMessage[CUT_MAX_LOCAL_MESSAGE_LENGTH];
+CUT_PRIVATE CUT_THREAD_LOCAL char *cut_localMessageCursor = NULL;
+CUT_PRIVATE CUT_THREAD_LOCAL int cut_inProcess = 0;
+CUT_PRIVATE CUT_THREAD_LOCAL int cut_unitThread = 0;
 CUT_PRIVATE cut_GlobalTear cut_globalTearUp = NULL;
 CUT_PRIVATE cut_GlobalTear cut_globalTearDown = NULL;
+CUT_PRIVATE cut_GlobalTear cut_globalSetupOnce = NULL;
+CUT_PRIVATE struct cut_Schedule cut_schedule;
+CUT_PRIVATE struct cut_History cut_history;
+CUT_PRIVATE struct cut_Cache cut_cache;
+CUT_PRIVATE struct cut_LastRun cut_lastRun;
+CUT_PRIVATE struct cut_Journal cut_journal;
+CUT_PRIVATE struct cut_Scaling cut_scaling;
+CUT_PRIVATE CUT_THREAD_LOCAL int cut_branched = 0;
+// progress reported by the running unit, beats are sent to the runner at most once per period
+CUT_PRIVATE CUT_THREAD_LOCAL int cut_heartbeatDone = 0;
+CUT_PRIVATE CUT_THREAD_LOCAL int64_t cut_heartbeatSent = 0;
 
 #endif // CUT_GLOBALS_H
\ No newline at end of file
@@ -0,0 +1,354 @@
+#ifndef CUT_HISTORY_H
+#define CUT_HISTORY_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+/* The history file keeps one line per unit:
+     <test name> <subtest> key=value ...
+   Unknown keys are skipped so that the file can be extended.
+   Besides the duration and the peak memory, the failure rate (in permille) is
+   kept along with the hash of the code of the test and the number of runs
+   since the hash changed, which tells how likely the unit is to fail now.
+   The last durations (samples=a,b,... oldest first) give adaptive timeouts.
+ */
+
+CUT_PRIVATE int cut_DurationComparator(const void *_lhs, const void *_rhs) {
+    int64_t lhs = *(const int64_t *)_lhs;
+    int64_t rhs = *(const int64_t *)_rhs;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+// records of units are kept sorted by test name and subtest in arrays of structures starting with cut_Record
+CUT_PRIVATE int cut_RecordPosition(const void *records, int size, size_t stride,
+                                   const char *name, int subtest, int *found) {
+    int low = 0;
+    int high = size;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        const struct cut_Record *record = (const struct cut_Record *)((const char *)records + middle * stride);
+        int order = strcmp(record->name, name);
+        if (!order)
+            order = record->subtest - subtest;
+        if (!order) {
+            *found = 1;
+            return middle;
+        }
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    *found = 0;
+    return low;
+}
+
+CUT_PRIVATE void *cut_InsertRecord(void **records, int *size, int *capacity, size_t stride,
+                                   const char *name, int subtest) {
+    int found;
+    int position = cut_RecordPosition(*records, *size, stride, name, subtest, &found);
+    if (found)
+        return (char *)*records + position * stride;
+    if (*size == *capacity) {
+        *capacity += 64;
+        *records = realloc(*records, stride * *capacity);
+        if (!*records)
+            cut_FatalExit("cannot allocate memory for records");
+    }
+    char *item = (char *)*records + position * stride;
+    memmove(item + stride, item, stride * (*size - position));
+    memset(item, 0, stride);
+    struct cut_Record *record = (struct cut_Record *)item;
+    record->name = (char *)malloc(strlen(name) + 1);
+    if (!record->name)
+        cut_FatalExit("cannot allocate memory for records");
+    strcpy(record->name, name);
+    record->subtest = subtest;
+    ++*size;
+    return item;
+}
+
+CUT_PRIVATE int cut_HistoryPosition(const char *name, int subtest, int *found) {
+    return cut_RecordPosition(cut_history.entries, cut_history.size, sizeof(struct cut_HistoryEntry),
+                              name, subtest, found);
+}
+
+CUT_PRIVATE struct cut_HistoryEntry *cut_FindHistory(const char *name, int subtest) {
+    int found;
+    int position = cut_HistoryPosition(name, subtest, &found);
+    return found ? &cut_history.entries[position] : NULL;
+}
+
+CUT_PRIVATE struct cut_HistoryEntry *cut_AddHistory(const char *name, int subtest) {
+    return (struct cut_HistoryEntry *)cut_InsertRecord((void **)&cut_history.entries, &cut_history.size,
+        &cut_history.capacity, sizeof(struct cut_HistoryEntry), name, subtest);
+}
+
+CUT_PRIVATE void cut_ParseHistoryValue(struct cut_HistoryEntry *entry, const char *key, const char *value) {
+    long long number;
+    if (!strcmp(key, "time") && sscanf(value, "%lld", &number) == 1)
+        entry->duration = number;
+    else if (!strcmp(key, "runs"))
+        sscanf(value, "%d", &entry->runs);
+    else if (!strcmp(key, "memory") && sscanf(value, "%lld", &number) == 1)
+        entry->memory = number;
+    else if (!strcmp(key, "failure"))
+        sscanf(value, "%d", &entry->failure);
+    else if (!strcmp(key, "age"))
+        sscanf(value, "%d", &entry->age);
+    else if (!strcmp(key, "key"))
+        entry->key = strtoull(value, NULL, 16);
+    else if (!strcmp(key, "samples")) {
+        for (const char *sample = value; *sample && entry->sampleCount < CUT_HISTORY_SAMPLES;) {
+            char *end;
+            entry->samples[entry->sampleCount++] = strtoll(sample, &end, 10);
+            if (*end != ',')
+                break;
+            sample = end + 1;
+        }
+    }
+}
+
+CUT_PRIVATE void cut_LoadHistory() {
+    if (!cut_arguments.history)
+        return;
+    cut_history.keys = (uint64_t *)malloc(sizeof(uint64_t) * (cut_unitTests.size + 1));
+    if (!cut_history.keys)
+        cut_FatalExit("cannot allocate memory for history");
+    // without the code of tests, changes of tests are not tracked
+    if (!cut_HashTests(cut_history.keys)) {
+        free(cut_history.keys);
+        cut_history.keys = NULL;
+    }
+    FILE *file = fopen(cut_arguments.history, "r");
+    if (!file)
+        return;
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        if (*line == '#')
+            continue;
+        char *name = strtok(line, " \t\r\n");
+        char *subtest = strtok(NULL, " \t\r\n");
+        if (!name || !subtest)
+            continue;
+        struct cut_HistoryEntry *entry = cut_AddHistory(name, atoi(subtest));
+        for (char *token; (token = strtok(NULL, " \t\r\n"));) {
+            char *value = strchr(token, '=');
+            if (!value)
+                continue;
+            *value++ = '\0';
+            cut_ParseHistoryValue(entry, token, value);
+        }
+    }
+    fclose(file);
+
+    // tests without history are expected to take as long as a typical one
+    int count = 0;
+    int64_t *durations = (int64_t *)malloc(sizeof(int64_t) * (cut_history.size + 1));
+    if (!durations)
+        cut_FatalExit("cannot allocate memory for history");
+    for (int i = 0; i < cut_history.size; ++i) {
+        if (cut_history.entries[i].runs)
+            durations[count++] = cut_history.entries[i].duration;
+    }
+    qsort(durations, count, sizeof(int64_t), cut_DurationComparator);
+    cut_history.typical = count ? durations[count / 2] : 0;
+    count = 0;
+    for (int i = 0; i < cut_history.size; ++i) {
+        if (cut_history.entries[i].memory)
+            durations[count++] = cut_history.entries[i].memory;
+    }
+    qsort(durations, count, sizeof(int64_t), cut_DurationComparator);
+    cut_history.typicalMemory = count ? durations[count / 2] : 0;
+    free(durations);
+}
+
+CUT_PRIVATE void cut_SaveHistory() {
+    if (!cut_arguments.history)
+        return;
+    size_t length = strlen(cut_arguments.history);
+    char *temporary = (char *)malloc(length + 5);
+    if (!temporary)
+        cut_FatalExit("cannot allocate memory for history");
+    sprintf(temporary, "%s.tmp", cut_arguments.history);
+    FILE *file = fopen(temporary, "w");
+    if (!file) {
+        free(temporary);
+        cut_ErrorExit("cannot open file %s for writing", cut_arguments.history);
+    }
+    fprintf(file, "# CUT history 1\n");
+    for (int i = 0; i < cut_history.size; ++i) {
+        const struct cut_HistoryEntry *entry = &cut_history.entries[i];
+        fprintf(file, "%s %d time=%lld runs=%d",
+                entry->record.name, entry->record.subtest, (long long)entry->duration, entry->runs);
+        if (entry->memory)
+            fprintf(file, " memory=%lld", (long long)entry->memory);
+        fprintf(file, " failure=%d age=%d", entry->failure, entry->age);
+        if (entry->key)
+            fprintf(file, " key=%016llx", (unsigned long long)entry->key);
+        for (int k = 0; k < entry->sampleCount; ++k)
+            fprintf(file, "%s%lld", k ? "," : " samples=", (long long)entry->samples[k]);
+        fprintf(file, "\n");
+    }
+    fclose(file) != EOF || cut_ErrorExit("cannot write file %s", cut_arguments.history);
+    rename(temporary, cut_arguments.history) != -1
+        || cut_ErrorExit("cannot replace file %s", cut_arguments.history);
+    free(temporary);
+}
+
+CUT_PRIVATE void cut_RecordDuration(int testId, int subtest, int64_t duration) {
+    if (!cut_arguments.history)
+        return;
+    struct cut_HistoryEntry *entry = cut_AddHistory(cut_unitTests.tests[testId].name, subtest);
+    // smoothed, so that a single slow run does not reorder the whole suite
+    entry->duration = entry->runs ? (3 * entry->duration + duration) / 4 : duration;
+    ++entry->runs;
+}
+
+CUT_PRIVATE void cut_RecordMemory(int testId, int subtest, int64_t memory) {
+    if (!cut_arguments.history || !memory)
+        return;
+    struct cut_HistoryEntry *entry = cut_AddHistory(cut_unitTests.tests[testId].name, subtest);
+    // a grown unit is trusted at once, a shrunk one only slowly, so that the budget is rather kept
+    entry->memory = memory > entry->memory ? memory : (3 * entry->memory + memory) / 4;
+}
+
+CUT_PRIVATE void cut_RecordFailure(int testId, int subtest, int failed) {
+    if (!cut_arguments.history)
+        return;
+    struct cut_HistoryEntry *entry = cut_AddHistory(cut_unitTests.tests[testId].name, subtest);
+    // recent outcomes weigh the most, an old failure is forgotten after a few passes
+    int outcome = failed ? 1000 : 0;
+    entry->failure = entry->runs > 1 ? (3 * entry->failure + outcome) / 4 : outcome;
+    if (!cut_history.keys)
+        return;
+    if (entry->key != cut_history.keys[testId]) {
+        entry->key = cut_history.keys[testId];
+        entry->age = 0;
+    } else if (entry->age < INT_MAX) {
+        ++entry->age;
+    }
+}
+
+CUT_PRIVATE void cut_RecordSample(int testId, int subtest, const struct cut_UnitResult *result) {
+    // a killed unit tells nothing about how long it would take
+    if (!cut_arguments.history || result->timeouted || result->signal)
+        return;
+    struct cut_HistoryEntry *entry = cut_AddHistory(cut_unitTests.tests[testId].name, subtest);
+    if (entry->sampleCount == CUT_HISTORY_SAMPLES) {
+        memmove(entry->samples, entry->samples + 1, sizeof(int64_t) * (CUT_HISTORY_SAMPLES - 1));
+        --entry->sampleCount;
+    }
+    entry->samples[entry->sampleCount++] = result->duration;
+}
+
+CUT_PRIVATE unsigned cut_AdaptiveTimeout(int testId, int subtest) {
+    if (!cut_arguments.timeoutFactor)
+        return 0;
+    const struct cut_HistoryEntry *entry = cut_FindHistory(cut_unitTests.tests[testId].name, subtest);
+    // a few runs are needed before a unit is trusted to be fast
+    if (!entry || entry->sampleCount < 3)
+        return 0;
+    int64_t samples[CUT_HISTORY_SAMPLES];
+    memcpy(samples, entry->samples, sizeof(int64_t) * entry->sampleCount);
+    qsort(samples, entry->sampleCount, sizeof(int64_t), cut_DurationComparator);
+    int64_t percentile = samples[(entry->sampleCount * 99 + 99) / 100 - 1];
+    int64_t timeout = percentile * cut_arguments.timeoutFactor / 1000 + 1;
+    if (timeout < cut_arguments.timeoutFloor)
+        timeout = cut_arguments.timeoutFloor;
+    if (timeout > cut_arguments.timeoutCeiling)
+        timeout = cut_arguments.timeoutCeiling;
+    return (unsigned)timeout;
+}
+
+CUT_PRIVATE int64_t cut_UnitValue(int testId, int subtest) {
+    const struct cut_HistoryEntry *entry = cut_FindHistory(cut_unitTests.tests[testId].name, subtest);
+    // chance of a failure in permille: a unit never run or changed since is a coin flip
+    int chance = 500;
+    if (entry && entry->runs && (!cut_history.keys || entry->key == cut_history.keys[testId]))
+        chance = entry->failure + (cut_history.keys ? 250 >> (entry->age < 8 ? entry->age : 8) : 0);
+    if (chance > 1000)
+        chance = 1000;
+    // every unit is worth something, even a stable one; the launch costs about a millisecond
+    return (int64_t)(chance + 10) * 1000000 / (cut_EstimateDuration(testId, subtest) + 1000);
+}
+
+CUT_PRIVATE int64_t cut_EstimateMemory(int testId, int subtest) {
+    const struct cut_HistoryEntry *entry = cut_FindHistory(cut_unitTests.tests[testId].name, subtest);
+    if (entry && entry->memory)
+        return entry->memory;
+    return cut_history.typicalMemory;
+}
+
+CUT_PRIVATE int64_t cut_EstimateDuration(int testId, int subtest) {
+    const char *name = cut_unitTests.tests[testId].name;
+    const struct cut_HistoryEntry *entry = cut_FindHistory(name, subtest);
+    if (entry && entry->runs)
+        return entry->duration;
+    if (!subtest)
+        return cut_history.typical;
+    // a new subtest is likely similar to its siblings
+    int found;
+    int64_t sum = 0;
+    int count = 0;
+    for (int i = cut_HistoryPosition(name, 1, &found); i < cut_history.size; ++i) {
+        entry = &cut_history.entries[i];
+        if (strcmp(entry->record.name, name))
+            break;
+        if (entry->runs) {
+            sum += entry->duration;
+            ++count;
+        }
+    }
+    return count ? sum / count : cut_history.typical;
+}
+
+CUT_PRIVATE int64_t cut_UnitPriority(int testId, int subtest) {
+    if (!cut_arguments.history)
+        return 0;
+    if (cut_arguments.timeBudget) {
+        // the most failures per second of the budget first
+        int64_t priority = cut_UnitValue(testId, subtest);
+        if (subtest)
+            return priority;
+        // the first run of a test unlocks its subtests, it is worth as much as the best of them
+        const char *name = cut_unitTests.tests[testId].name;
+        int found;
+        for (int i = cut_HistoryPosition(name, 1, &found); i < cut_history.size; ++i) {
+            const struct cut_HistoryEntry *entry = &cut_history.entries[i];
+            if (strcmp(entry->record.name, name))
+                break;
+            int64_t value = cut_UnitValue(testId, entry->record.subtest);
+            if (value > priority)
+                priority = value;
+        }
+        return priority;
+    }
+    int64_t priority = cut_EstimateDuration(testId, subtest);
+    if (subtest)
+        return priority;
+    // the first run of a test unlocks all its subtests
+    const char *name = cut_unitTests.tests[testId].name;
+    int found;
+    for (int i = cut_HistoryPosition(name, 1, &found); i < cut_history.size; ++i) {
+        const struct cut_HistoryEntry *entry = &cut_history.entries[i];
+        if (strcmp(entry->record.name, name))
+            break;
+        priority += entry->duration;
+    }
+    return priority;
+}
+
+CUT_PRIVATE void cut_CleanHistory() {
+    for (int i = 0; i < cut_history.size; ++i)
+        free(cut_history.entries[i].record.name);
+    free(cut_history.entries);
+    free(cut_history.keys);
+    cut_history.entries = NULL;
+    cut_history.keys = NULL;
+    cut_history.size = 0;
+    cut_history.capacity = 0;
+}
+
+#endif // CUT_HISTORY_H
@@ -0,0 +1,254 @@
+#ifndef CUT_JOURNAL_H
+#define CUT_JOURNAL_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+/* The journal is a sequence of messages serialized the same way units send
+   them to the runner. The messages of a finished unit (subtest, debug, check,
+   fail, exception) are followed by a result message which closes its record:
+     <test name> <subtest> <subtests> <number> <failed> <return code> <signal>
+     <timeouted> <timeout> <duration> <memory>
+   Messages are only appended, so a runner killed in the middle of a write
+   leaves an unclosed record at the end, which is not resumed.
+ */
+
+CUT_PRIVATE struct cut_JournalEntry *cut_FindJournal(const char *name, int subtest) {
+    int found;
+    int position = cut_RecordPosition(cut_journal.entries, cut_journal.size, sizeof(struct cut_JournalEntry),
+                                      name, subtest, &found);
+    return found ? &cut_journal.entries[position] : NULL;
+}
+
+CUT_PRIVATE struct cut_JournalEntry *cut_AddJournal(const char *name, int subtest) {
+    return (struct cut_JournalEntry *)cut_InsertRecord((void **)&cut_journal.entries, &cut_journal.size,
+        &cut_journal.capacity, sizeof(struct cut_JournalEntry), name, subtest);
+}
+
+CUT_PRIVATE void cut_JournalValue(struct cut_Fragment *message, const void *value, size_t length) {
+    void *slice = cut_FragmentReserve(message, length, NULL);
+    if (!slice)
+        cut_FatalExit("cannot insert journal:fragment");
+    memcpy(slice, value, length);
+}
+
+CUT_PRIVATE void cut_ResultValue(struct cut_Fragment *message, int sliceId, void *value, size_t length) {
+    size_t sliceLength = 0;
+    const char *slice = cut_FragmentGet(message, sliceId, &sliceLength);
+    if (slice && sliceLength == length)
+        memcpy(value, slice, length);
+}
+
+CUT_PRIVATE void cut_WriteJournal(struct cut_Fragment *message) {
+    cut_FragmentSerialize(message) || cut_FatalExit("cannot serialize journal:fragment");
+    fwrite(message->serialized, 1, message->serializedLength, cut_journal.file) == message->serializedLength
+        || cut_ErrorExit("cannot write journal");
+    cut_FragmentClean(message);
+}
+
+CUT_PRIVATE void cut_JournalInfo(int id, const struct cut_Info *info) {
+    for (; info; info = info->next) {
+        struct cut_Fragment message;
+        cut_FragmentInit(&message, id);
+        size_t line = (size_t)info->line;
+        cut_JournalValue(&message, &line, sizeof(line));
+        (cut_FragmentAddString(&message, info->file) && cut_FragmentAddString(&message, info->message))
+            || cut_FatalExit("cannot insert journal:fragment");
+        cut_WriteJournal(&message);
+    }
+}
+
+CUT_PRIVATE void cut_RecordJournal(int testId, int subtest, const struct cut_UnitResult *result) {
+    if (!cut_journal.file)
+        return;
+    struct cut_Fragment message;
+    if (result->name) {
+        cut_FragmentInit(&message, cut_MESSAGE_SUBTEST);
+        cut_JournalValue(&message, &result->number, sizeof(result->number));
+        cut_FragmentAddString(&message, result->name) || cut_FatalExit("cannot insert journal:fragment");
+        cut_WriteJournal(&message);
+    }
+    cut_JournalInfo(cut_MESSAGE_DEBUG, result->debug);
+    cut_JournalInfo(cut_MESSAGE_CHECK, result->check);
+    if (result->statement) {
+        cut_FragmentInit(&message, cut_MESSAGE_FAIL);
+        size_t line = (size_t)result->line;
+        cut_JournalValue(&message, &line, sizeof(line));
+        (cut_FragmentAddString(&message, result->file) && cut_FragmentAddString(&message, result->statement))
+            || cut_FatalExit("cannot insert journal:fragment");
+        cut_WriteJournal(&message);
+    }
+    if (result->exceptionType) {
+        cut_FragmentInit(&message, cut_MESSAGE_EXCEPTION);
+        (cut_FragmentAddString(&message, result->exceptionType)
+         && cut_FragmentAddString(&message, result->exceptionMessage))
+            || cut_FatalExit("cannot insert journal:fragment");
+        cut_WriteJournal(&message);
+    }
+    cut_FragmentInit(&message, cut_MESSAGE_RESULT);
+    cut_FragmentAddString(&message, cut_unitTests.tests[testId].name) || cut_FatalExit("cannot insert journal:fragment");
+    cut_JournalValue(&message, &subtest, sizeof(subtest));
+    cut_JournalValue(&message, &result->subtests, sizeof(result->subtests));
+    cut_JournalValue(&message, &result->number, sizeof(result->number));
+    cut_JournalValue(&message, &result->failed, sizeof(result->failed));
+    cut_JournalValue(&message, &result->returnCode, sizeof(result->returnCode));
+    cut_JournalValue(&message, &result->signal, sizeof(result->signal));
+    cut_JournalValue(&message, &result->timeouted, sizeof(result->timeouted));
+    cut_JournalValue(&message, &result->timeout, sizeof(result->timeout));
+    cut_JournalValue(&message, &result->duration, sizeof(result->duration));
+    cut_JournalValue(&message, &result->memory, sizeof(result->memory));
+    cut_WriteJournal(&message);
+
+    // a killed runner loses nothing written so far, a crashed machine loses at most the last period
+    fflush(cut_journal.file) != EOF || cut_ErrorExit("cannot write journal");
+    int64_t now = cut_Now();
+    if (now - cut_journal.synced >= CUT_JOURNAL_SYNC_PERIOD) {
+        cut_SyncFile(cut_journal.file);
+        cut_journal.synced = now;
+    }
+}
+
+CUT_PRIVATE void cut_CloseRecord(struct cut_Fragment *message, struct cut_UnitResult *pending) {
+    const char *name = cut_FragmentGet(message, 0, NULL);
+    if (message->sliceCount != 11 || !name) {
+        cut_CleanMemory(pending);
+        return;
+    }
+    int subtest = 0;
+    cut_ResultValue(message, 1, &subtest, sizeof(subtest));
+    cut_ResultValue(message, 2, &pending->subtests, sizeof(pending->subtests));
+    cut_ResultValue(message, 3, &pending->number, sizeof(pending->number));
+    cut_ResultValue(message, 4, &pending->failed, sizeof(pending->failed));
+    cut_ResultValue(message, 5, &pending->returnCode, sizeof(pending->returnCode));
+    cut_ResultValue(message, 6, &pending->signal, sizeof(pending->signal));
+    cut_ResultValue(message, 7, &pending->timeouted, sizeof(pending->timeouted));
+    cut_ResultValue(message, 8, &pending->timeout, sizeof(pending->timeout));
+    cut_ResultValue(message, 9, &pending->duration, sizeof(pending->duration));
+    cut_ResultValue(message, 10, &pending->memory, sizeof(pending->memory));
+    // a unit run again after an earlier resume has the latest record
+    struct cut_JournalEntry *entry = cut_AddJournal(name, subtest);
+    cut_CleanMemory(&entry->result);
+    entry->result = *pending;
+}
+
+CUT_PRIVATE void cut_LoadJournal(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return;
+    char *data = NULL;
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) || (length = ftell(file)) < 0 || fseek(file, 0, SEEK_SET))
+        cut_ErrorExit("cannot read file %s", path);
+    size_t size = (size_t)length;
+    if (size) {
+        data = (char *)malloc(size);
+        if (!data)
+            cut_FatalExit("cannot allocate memory for journal");
+        fread(data, 1, size, file) == size || cut_ErrorExit("cannot read file %s", path);
+    }
+    fclose(file);
+
+    struct cut_UnitResult pending;
+    memset(&pending, 0, sizeof(pending));
+    size_t offset = 0;
+    while (size - offset >= sizeof(struct cut_FragmentHeader)) {
+        struct cut_FragmentHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.length < sizeof(header) || size - offset < header.length)
+            break;
+
+        struct cut_Fragment message;
+        cut_FragmentInit(&message, cut_NO_TYPE);
+        message.serialized = (char *)malloc(header.length);
+        if (!message.serialized)
+            cut_FatalExit("cannot allocate memory for journal");
+        memcpy(message.serialized, data + offset, header.length);
+        cut_FragmentDeserialize(&message) || cut_FatalExit("cannot deserialize journal:fragment");
+        if (message.id == cut_MESSAGE_RESULT) {
+            cut_CloseRecord(&message, &pending);
+            memset(&pending, 0, sizeof(pending));
+        } else {
+            cut_ProcessMessage(&message, &pending);
+        }
+        cut_FragmentClean(&message);
+        offset += header.length;
+    }
+    cut_CleanMemory(&pending);
+    free(data);
+}
+
+CUT_PRIVATE void cut_OpenJournal() {
+    const char *path = cut_arguments.journal ? cut_arguments.journal : cut_arguments.resume;
+    if (!path)
+        return;
+    if (cut_arguments.resume)
+        cut_LoadJournal(cut_arguments.resume);
+    // a new journal starts empty and gets the resumed results as they are taken over
+    cut_journal.copy = cut_arguments.resume && strcmp(path, cut_arguments.resume);
+    int append = cut_arguments.resume && !cut_journal.copy;
+    cut_journal.file = fopen(path, append ? "ab" : "wb");
+    if (!cut_journal.file)
+        cut_ErrorExit("cannot open file %s for writing", path);
+    cut_journal.synced = cut_Now();
+}
+
+CUT_PRIVATE void cut_ResumeUnit(int testId, int subtest, struct cut_JournalEntry *entry) {
+    struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+    struct cut_UnitResult *result = &progress->results[subtest];
+    if (cut_journal.copy)
+        cut_RecordJournal(testId, subtest, &entry->result);
+    *result = entry->result;
+    memset(&entry->result, 0, sizeof(entry->result));
+    progress->finished[subtest] = 1;
+    cut_RecordCache(testId, subtest, result);
+    cut_RecordOutcome(testId, subtest, result);
+    if (result->failed)
+        ++progress->failed;
+    ++cut_journal.resumedUnits;
+}
+
+CUT_PRIVATE int cut_ResumedTest(int testId) {
+    // the record of the first run tells how many subtests there are, without it the test starts over
+    if (!cut_journal.size || cut_arguments.subtestId >= 0 || cut_arguments.rerunFailed)
+        return 0;
+    const char *name = cut_unitTests.tests[testId].name;
+    struct cut_JournalEntry *first = cut_FindJournal(name, 0);
+    if (!first)
+        return 0;
+
+    struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+    int subtests = first->result.subtests;
+    cut_ReserveResults(progress, subtests);
+    progress->subtests = subtests;
+    for (int subtest = 0; subtest <= subtests; ++subtest) {
+        struct cut_JournalEntry *entry = cut_FindJournal(name, subtest);
+        if (entry)
+            cut_ResumeUnit(testId, subtest, entry);
+        else
+            cut_EnqueueUnit(testId, subtest, 0, 0);
+    }
+    ++cut_journal.resumedTests;
+    return 1;
+}
+
+CUT_PRIVATE void cut_CloseJournal() {
+    if (!cut_journal.file)
+        return;
+    cut_SyncFile(cut_journal.file);
+    fclose(cut_journal.file) != EOF || cut_ErrorExit("cannot write journal");
+    cut_journal.file = NULL;
+}
+
+CUT_PRIVATE void cut_CleanJournal() {
+    for (int i = 0; i < cut_journal.size; ++i) {
+        free(cut_journal.entries[i].record.name);
+        cut_CleanMemory(&cut_journal.entries[i].result);
+    }
+    free(cut_journal.entries);
+    if (cut_journal.file)
+        fclose(cut_journal.file);
+    memset(&cut_journal, 0, sizeof(cut_journal));
+}
+
+#endif // CUT_JOURNAL_H
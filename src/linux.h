@@ -6,8 +6,45 @@
 # include <sys/wait.h>
 # include <sys/types.h>
 # include <sys/prctl.h>
+# include <sys/socket.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+# include <sys/mount.h>
+# include <sys/ioctl.h>
+# include <net/if.h>
+# include <dirent.h>
+# include <pthread.h>
+# include <ftw.h>
+# include <sched.h>
+# include <spawn.h>
+# include <sys/syscall.h>
 # include <fcntl.h>
 # include <signal.h>
+# include <time.h>
+# include <poll.h>
+# include <errno.h>
+# include <elf.h>
+# include <link.h>
+# include <sys/inotify.h>
+
+CUT_PRIVATE int cut_zygotePid = 0;
+CUT_PRIVATE int cut_zygoteControl = -1;
+CUT_PRIVATE char cut_watchedBinary[PATH_MAX];
+CUT_PRIVATE uint64_t cut_watchedStamp = 0;
+
+enum { cut_GUARDED_SIGNALS = 4 };
+CUT_PRIVATE const int cut_guardedSignals[cut_GUARDED_SIGNALS] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+CUT_PRIVATE struct sigaction cut_guardedActions[cut_GUARDED_SIGNALS];
+CUT_PRIVATE char *cut_alternateStack = NULL;
+// the alarm and timers of the process belong to the tests, a unit run by the runner is timed by a watchdog thread
+# define CUT_TIMEOUT_SIGNAL SIGRTMAX
+CUT_PRIVATE pthread_mutex_t cut_watchdogLock = PTHREAD_MUTEX_INITIALIZER;
+CUT_PRIVATE pthread_cond_t cut_watchdogWake = PTHREAD_COND_INITIALIZER;
+CUT_PRIVATE pthread_t cut_watchdogTarget;
+CUT_PRIVATE int cut_watchdogStarted = 0;
+CUT_PRIVATE unsigned cut_guardTimeout = 0;
+CUT_PRIVATE int64_t cut_guardDeadline = 0;
+CUT_PRIVATE volatile sig_atomic_t cut_guardActive = 0;
 
 CUT_PRIVATE int cut_IsTerminalOutput() {
     return isatty(fileno(stdout));
@@ -25,15 +62,125 @@ CUT_PRIVATE void cut_RedirectIO() {
 }
 
 CUT_PRIVATE void cut_ResumeIO() {
+    // buffered output of the unit must not outlive it, a batch runs more of them
+    fflush(stdout);
+    fflush(stderr);
     fclose(cut_stdout) != -1 || cut_FatalExit("cannot close file");
     fclose(cut_stderr) != -1 || cut_FatalExit("cannot close file");
     close(1) != -1 || cut_FatalExit("cannot close file");
     close(2) != -1 || cut_FatalExit("cannot close file");
     dup2(cut_originalStdOut, 1);
     dup2(cut_originalStdErr, 2);
+    close(cut_originalStdOut);
+    close(cut_originalStdErr);
     cut_outputsRedirected = 0;
 }
 
+struct cut_ThreadStart {
+    int pipeWrite;
+    int count;
+    struct cut_UnitId *units;
+};
+
+CUT_PRIVATE void *cut_ThreadMain(void *data) {
+    struct cut_ThreadStart *start = (struct cut_ThreadStart *)data;
+    cut_unitThread = 1;
+    cut_pipeWrite = start->pipeWrite;
+    cut_RunBatch(start->units, start->count);
+    cut_SendStatus(0, 0);
+    close(cut_pipeWrite);
+    free(start->units);
+    free(start);
+    return NULL;
+}
+
+CUT_PRIVATE void cut_LaunchThread(struct cut_Slot *slot) {
+    int pipefd[2];
+    pipe(pipefd) != -1 || cut_FatalExit("cannot establish communication pipe");
+    // spawned units must not keep the pipe, forked ones do not matter as the end is reported
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC) != -1 || cut_FatalExit("cannot set close-on-exec");
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC) != -1 || cut_FatalExit("cannot set close-on-exec");
+    fcntl(pipefd[0], F_SETFL, O_NONBLOCK) != -1 || cut_FatalExit("cannot set non-blocking pipe");
+
+    struct cut_ThreadStart *start = (struct cut_ThreadStart *)malloc(sizeof(struct cut_ThreadStart));
+    if (!start)
+        cut_FatalExit("cannot allocate memory for thread");
+    start->units = (struct cut_UnitId *)malloc(sizeof(struct cut_UnitId) * slot->batchSize);
+    if (!start->units)
+        cut_FatalExit("cannot allocate memory for thread");
+    memcpy(start->units, slot->batch, sizeof(struct cut_UnitId) * slot->batchSize);
+    start->count = slot->batchSize;
+    start->pipeWrite = pipefd[1];
+
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attributes, cut_ThreadMain, start) == 0 || cut_FatalExit("cannot start thread");
+    pthread_attr_destroy(&attributes);
+
+    slot->pipeRead = pipefd[0];
+}
+
+CUT_PRIVATE char *cut_MakePrivateRoot() {
+    const char *base = getenv("CUT_TMPDIR");
+    // scratch files of units do not need to outlive the run, memory is the fastest place for them
+    if (!base && access("/dev/shm", W_OK) == 0)
+        base = "/dev/shm";
+    if (!base)
+        base = getenv("TMPDIR");
+    if (!base)
+        base = "/tmp";
+    char *root = (char *)malloc(strlen(base) + 12);
+    if (!root)
+        cut_FatalExit("cannot allocate memory for private directory");
+    sprintf(root, "%s/cut-XXXXXX", base);
+    if (!mkdtemp(root))
+        cut_ErrorExit("cannot create private directory in %s", base);
+    return root;
+}
+
+CUT_PRIVATE int cut_UnitPid() {
+    if (!cut_arguments.sandbox)
+        return getpid();
+    // the unit sees pids of its own namespace, the runner knows it by the one in /proc
+    char link[32];
+    ssize_t length = readlink("/proc/self", link, sizeof(link) - 1);
+    if (length <= 0)
+        cut_FatalExit("cannot get pid of unit");
+    link[length] = 0;
+    return atoi(link);
+}
+
+CUT_PRIVATE void cut_EnterPrivateDir(int testId, int subtest, int index) {
+    if (!cut_arguments.privateRoot || cut_unitThread)
+        return;
+    // the runner looks for the log in its own directory
+    static char emergencyLog[4096];
+    if (*cut_emergencyLog != '/') {
+        char directory[4096];
+        getcwd(directory, sizeof(directory)) || cut_FatalExit("cannot get working directory");
+        snprintf(emergencyLog, sizeof(emergencyLog), "%s/%s", directory, cut_emergencyLog);
+        cut_emergencyLog = emergencyLog;
+    }
+    char path[4096];
+    cut_PrivateDir(path, sizeof(path), testId, subtest, cut_UnitPid(), index);
+    mkdir(path, 0700) != -1 || cut_FatalExit("cannot create private directory");
+    chdir(path) != -1 || cut_FatalExit("cannot enter private directory");
+    setenv("CUT_TEST_DIR", path, 1) != -1 || cut_FatalExit("cannot set CUT_TEST_DIR");
+}
+
+CUT_PRIVATE int cut_RemoveEntry(const char *path, CUT_UNUSED(const struct stat *status),
+                                CUT_UNUSED(int type), CUT_UNUSED(struct FTW *position))
+{
+    remove(path);
+    return 0;
+}
+
+CUT_PRIVATE void cut_RemoveTree(const char *path) {
+    nftw(path, cut_RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
 CUT_PRIVATE int64_t cut_Read(int fd, char *destination, size_t bytes) {
     return read(fd, destination, bytes);
 }
@@ -42,60 +189,710 @@ CUT_PRIVATE int64_t cut_Write(int fd, const char *source, size_t bytes) {
     return write(fd, source, bytes);
 }
 
+CUT_PRIVATE int cut_WriteProcFile(const char *path, const char *content) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+    int64_t length = (int64_t)strlen(content);
+    int written = write(fd, content, length) == length;
+    close(fd);
+    return written;
+}
+
+CUT_PRIVATE void cut_EnterSandbox() {
+    if (!cut_arguments.sandbox)
+        return;
+    char uidMap[32];
+    char gidMap[32];
+    sprintf(uidMap, "%u %u 1", (unsigned)getuid(), (unsigned)getuid());
+    sprintf(gidMap, "%u %u 1", (unsigned)getgid(), (unsigned)getgid());
+    unshare(CLONE_NEWUSER | CLONE_NEWNS | CLONE_NEWNET | CLONE_NEWPID) != -1
+        || cut_FatalExit("cannot create namespaces of sandbox");
+    // the unit keeps its identity, only capabilities inside of the namespaces are gained
+    cut_WriteProcFile("/proc/self/setgroups", "deny");
+    (cut_WriteProcFile("/proc/self/uid_map", uidMap) && cut_WriteProcFile("/proc/self/gid_map", gidMap))
+        || cut_FatalExit("cannot map user of sandbox");
+    mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != -1 || cut_FatalExit("cannot make mounts private");
+
+    // the new network namespace has nothing but loopback, which is down
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sock != -1 || cut_FatalExit("cannot open socket");
+    struct ifreq request;
+    memset(&request, 0, sizeof(request));
+    strcpy(request.ifr_name, "lo");
+    ioctl(sock, SIOCGIFFLAGS, &request) != -1 || cut_FatalExit("cannot bring loopback up");
+    request.ifr_flags |= IFF_UP;
+    ioctl(sock, SIOCSIFFLAGS, &request) != -1 || cut_FatalExit("cannot bring loopback up");
+    close(sock);
+
+    // init of the new pid namespace runs the unit, whatever the unit leaves behind dies with init;
+    // the unit itself must not be init, init ignores signals the unit would raise
+    int report[2];
+    pipe2(report, O_CLOEXEC) != -1 || cut_FatalExit("cannot establish communication pipe");
+    int pid = fork();
+    if (pid == -1)
+        cut_FatalExit("cannot fork into sandbox");
+    if (!pid) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL) != -1 || cut_FatalExit("cannot set child death signal");
+        close(report[0]);
+        int unit = fork();
+        if (unit == -1)
+            cut_FatalExit("cannot fork into sandbox");
+        if (!unit) {
+            close(report[1]);
+            return;
+        }
+        close(cut_pipeWrite);
+        int status = 0;
+        int r;
+        // orphans of the unit are reaped on the way
+        do {
+            r = waitpid(-1, &status, 0);
+        } while (r != unit && (r != -1 || errno == EINTR));
+        if (r == unit)
+            write(report[1], &status, sizeof(status));
+        _exit(cut_NORMAL_EXIT);
+    }
+    close(cut_pipeWrite);
+    close(report[1]);
+    int status = 0;
+    int r;
+    do {
+        r = read(report[0], &status, sizeof(status));
+    } while (r == -1 && errno == EINTR);
+    // init is reaped as well, so that the peak memory of the unit is accounted to this process
+    waitpid(pid, NULL, 0);
+    if (r != sizeof(status))
+        _exit(cut_FATAL_EXIT);
+    if (!WIFSIGNALED(status))
+        _exit(WIFEXITED(status) ? WEXITSTATUS(status) : cut_FATAL_EXIT);
+    // the runner gets the same signal as if there were no sandbox
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, WTERMSIG(status));
+    signal(WTERMSIG(status), SIG_DFL);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+    raise(WTERMSIG(status));
+    _exit(cut_FATAL_EXIT);
+}
+
+CUT_PRIVATE uint64_t cut_ChangeStamp(uint64_t hash, const char *path) {
+    struct stat info;
+    if (stat(path, &info))
+        return cut_HashMix(hash);
+    hash = cut_HashBytes(hash, &info.st_ino, sizeof(info.st_ino));
+    hash = cut_HashBytes(hash, &info.st_size, sizeof(info.st_size));
+    return cut_HashBytes(hash, &info.st_mtime, sizeof(info.st_mtime));
+}
+
+// the path is taken before a relink can make /proc/self/exe point to the deleted file
+CUT_PRIVATE void cut_RememberBinary() {
+    ssize_t length = readlink("/proc/self/exe", cut_watchedBinary, sizeof(cut_watchedBinary) - 1);
+    if (length <= 0)
+        cut_FatalExit("cannot read path of the binary");
+    cut_watchedBinary[length] = '\0';
+    cut_watchedStamp = cut_ChangeStamp(0, cut_watchedBinary);
+}
+
 CUT_PRIVATE int cut_PreRun() {
-    return 0;
+    if (cut_arguments.pipe < 0) {
+        if (cut_arguments.watch)
+            cut_RememberBinary();
+        return 0;
+    }
+
+    // re-executed by cut_SpawnUnit to run a unit or a batch of units
+    prctl(PR_SET_PDEATHSIG, SIGTERM) != -1 || cut_FatalExit("cannot set child death signal");
+    cut_pipeWrite = cut_arguments.pipe;
+    cut_emergencyLog = cut_EmergencyLog(getpid());
+    cut_EnterSandbox();
+    if (cut_globalSetupOnce)
+        cut_globalSetupOnce();
+
+    if (cut_arguments.unitCount) {
+        cut_RunBatch(cut_arguments.units, cut_arguments.unitCount);
+    } else {
+        struct cut_UnitId unit = {cut_arguments.testId, cut_arguments.subtestId, 0};
+        cut_RunBatch(&unit, 1);
+    }
+
+    close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
+    return 1;
 }
 
-CUT_PRIVATE void cut_SigAlrm(CUT_UNUSED(int signum)) {
-    cut_Timeouted();
-    _exit(cut_NORMAL_EXIT);
+CUT_PRIVATE int cut_ProcessorCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
 }
 
-CUT_PRIVATE void cut_RunUnit(int testId, int subtest, struct cut_UnitResult *result) {
+CUT_PRIVATE double cut_ReadStall(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    double stall = -1;
+    if (fscanf(file, "some avg10=%lf", &stall) != 1)
+        stall = -1;
+    fclose(file);
+    return stall;
+}
+
+CUT_PRIVATE int cut_ReadPressure(struct cut_Pressure *pressure) {
+    // pressure stall information is missing in kernels before 4.20 or without CONFIG_PSI
+    pressure->cpu = cut_ReadStall("/proc/pressure/cpu");
+    pressure->memory = cut_ReadStall("/proc/pressure/memory");
+    pressure->io = cut_ReadStall("/proc/pressure/io");
+    pressure->load = -1;
+    FILE *file = fopen("/proc/loadavg", "r");
+    if (file) {
+        if (fscanf(file, "%lf", &pressure->load) == 1)
+            pressure->load /= cut_ProcessorCount();
+        else
+            pressure->load = -1;
+        fclose(file);
+    }
+    return pressure->cpu >= 0 || pressure->memory >= 0 || pressure->io >= 0 || pressure->load >= 0;
+}
+
+CUT_PRIVATE int cut_PidOpen(int pid) {
+# if defined(SYS_pidfd_open)
+    return syscall(SYS_pidfd_open, pid, 0);
+# else
+    (void)pid;
+    return -1;
+# endif
+}
+
+CUT_PRIVATE int64_t cut_Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+CUT_PRIVATE int cut_SpawnUnit(struct cut_Slot *slot, int pipeWrite) {
+    char test[16];
+    char subtest[16];
+    char pipe[16];
+    sprintf(test, "%d", slot->unit.testId);
+    sprintf(subtest, "%d", slot->unit.subtest);
+    sprintf(pipe, "%d", pipeWrite);
+    char *units = (char *)malloc(slot->batchSize * 24 + 1);
+    if (!units)
+        cut_FatalExit("cannot allocate memory for list of units");
+    char *cursor = units;
+    for (int i = 0; i < slot->batchSize; ++i)
+        cursor += sprintf(cursor, "%s%d:%d", i ? "," : "", slot->batch[i].testId, slot->batch[i].subtest);
+    char *argv[] = {
+        (char *)cut_arguments.selfName,
+        (char *)"--test", test,
+        (char *)"--subtest", subtest,
+        (char *)"--pipe", pipe,
+        (char *)"--units", units,
+        NULL, NULL, NULL, NULL, NULL
+    };
+    int argc = 9;
+    if (cut_arguments.forkSubtests)
+        argv[argc++] = (char *)"--fork-subtests";
+    if (cut_arguments.sandbox)
+        argv[argc++] = (char *)"--sandbox";
+    if (cut_arguments.privateRoot) {
+        argv[argc++] = (char *)"--private-root";
+        argv[argc++] = cut_arguments.privateRoot;
+    }
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes) == 0 || cut_FatalExit("cannot initialize spawn attributes");
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    int pid;
+    posix_spawn(&pid, "/proc/self/exe", NULL, &attributes, argv, environ) == 0
+        || cut_FatalExit("cannot spawn unit");
+    posix_spawnattr_destroy(&attributes);
+    free(units);
+    return pid;
+}
+
+CUT_PRIVATE void cut_RunLaunchedUnit(int parentPid, int pipeWrite, const struct cut_UnitId *units, int count) {
+    prctl(PR_SET_PDEATHSIG, SIGTERM) != -1 || cut_FatalExit("cannot set child death signal");
+    if (getppid() != parentPid)
+        exit(cut_ERROR_EXIT);
+    setpgid(0, 0);
+    cut_pipeWrite = pipeWrite;
+    cut_emergencyLog = cut_EmergencyLog(getpid());
+    cut_EnterSandbox();
+    cut_RunBatch(units, count);
+
+    close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
+    cut_CleanSchedule();
+    free(cut_unitTests.tests);
+    free(cut_arguments.match);
+    free(cut_arguments.units);
+    if (cut_arguments.output)
+        fclose(cut_output);
+    exit(cut_NORMAL_EXIT);
+}
+
+CUT_PRIVATE void cut_ZygoteLoop(int control, int runnerPid) {
+    size_t capacity = sizeof(int) + sizeof(struct cut_UnitId) * cut_arguments.batch;
+    char *request = (char *)malloc(capacity);
+    if (!request)
+        cut_FatalExit("cannot allocate memory for zygote request");
+    for (;;) {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct iovec vector = {request, capacity};
+        struct msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_iov = &vector;
+        header.msg_iovlen = 1;
+        header.msg_control = buffer;
+        header.msg_controllen = sizeof(buffer);
+        int64_t r;
+        do {
+            r = recvmsg(control, &header, 0);
+        } while (r == -1 && errno == EINTR);
+        // the runner is done
+        if (r <= 0)
+            break;
+        struct cmsghdr *item = CMSG_FIRSTHDR(&header);
+        if (!item || item->cmsg_level != SOL_SOCKET || item->cmsg_type != SCM_RIGHTS)
+            cut_FatalExit("zygote request without pipe");
+        int pipeWrite;
+        int count;
+        memcpy(&pipeWrite, CMSG_DATA(item), sizeof(int));
+        memcpy(&count, request, sizeof(int));
+
+        fflush(stdout);
+        fflush(stderr);
+        // the unit becomes a child of the runner which reaps and kills it as any other
+        int pid = (int)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, NULL, NULL, 0);
+        if (!pid) {
+            close(control);
+            cut_RunLaunchedUnit(runnerPid, pipeWrite, (const struct cut_UnitId *)(request + sizeof(int)), count);
+        }
+        close(pipeWrite) != -1 || cut_FatalExit("cannot close file");
+        send(control, &pid, sizeof(pid), 0) == sizeof(pid) || cut_FatalExit("cannot answer runner");
+    }
+    free(request);
+}
+
+CUT_PRIVATE void cut_StartZygote() {
+    if (!cut_globalSetupOnce)
+        return;
+    // units run in the runner need the setup there, the isolated ones are spawned later
+    if (cut_arguments.noFork || cut_arguments.autoIsolate || cut_arguments.threads) {
+        cut_globalSetupOnce();
+        return;
+    }
+    // re-executed units cannot inherit anything, they do the setup on their own
+    if (cut_arguments.spawn)
+        return;
+
+    int sockets[2];
+    socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != -1
+        || cut_FatalExit("cannot create zygote socket");
+    fflush(cut_output);
+    int runnerPid = getpid();
+    int pid = fork();
+    if (pid == -1)
+        cut_FatalExit("cannot fork");
+    if (!pid) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL) != -1 || cut_FatalExit("cannot set child death signal");
+        if (getppid() != runnerPid)
+            exit(cut_ERROR_EXIT);
+        close(sockets[0]) != -1 || cut_FatalExit("cannot close file");
+        cut_globalSetupOnce();
+        int ready = 0;
+        send(sockets[1], &ready, sizeof(ready), 0) == sizeof(ready) || cut_FatalExit("cannot notify runner");
+        cut_ZygoteLoop(sockets[1], runnerPid);
+
+        close(sockets[1]) != -1 || cut_FatalExit("cannot close file");
+        free(cut_unitTests.tests);
+        free(cut_arguments.match);
+        free(cut_arguments.units);
+        if (cut_arguments.output)
+            fclose(cut_output);
+        exit(cut_NORMAL_EXIT);
+    }
+    close(sockets[1]) != -1 || cut_FatalExit("cannot close file");
+    int ready;
+    if (recv(sockets[0], &ready, sizeof(ready), 0) != sizeof(ready))
+        cut_ErrorExit("global setup once has failed");
+    cut_zygotePid = pid;
+    cut_zygoteControl = sockets[0];
+}
+
+CUT_PRIVATE void cut_StopZygote() {
+    if (!cut_zygotePid)
+        return;
+    close(cut_zygoteControl) != -1 || cut_FatalExit("cannot close file");
+    int r;
+    do {
+        r = waitpid(cut_zygotePid, NULL, 0);
+    } while (r == -1 && errno == EINTR);
+    cut_zygotePid = 0;
+    cut_zygoteControl = -1;
+}
+
+CUT_PRIVATE int cut_ZygoteUnit(struct cut_Slot *slot, int pipeWrite) {
+    int count = slot->batchSize;
+    size_t length = sizeof(int) + sizeof(struct cut_UnitId) * count;
+    char *request = (char *)malloc(length);
+    if (!request)
+        cut_FatalExit("cannot allocate memory for zygote request");
+    memcpy(request, &count, sizeof(int));
+    memcpy(request + sizeof(int), slot->batch, sizeof(struct cut_UnitId) * count);
+
+    char buffer[CMSG_SPACE(sizeof(int))];
+    memset(buffer, 0, sizeof(buffer));
+    struct iovec vector = {request, length};
+    struct msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+    header.msg_control = buffer;
+    header.msg_controllen = sizeof(buffer);
+    struct cmsghdr *item = CMSG_FIRSTHDR(&header);
+    item->cmsg_level = SOL_SOCKET;
+    item->cmsg_type = SCM_RIGHTS;
+    item->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(item), &pipeWrite, sizeof(int));
+
+    sendmsg(cut_zygoteControl, &header, 0) == (int64_t)length || cut_FatalExit("cannot send request to zygote");
+    free(request);
+    int pid;
+    recv(cut_zygoteControl, &pid, sizeof(pid), 0) == sizeof(pid) || cut_FatalExit("zygote does not respond");
+    return pid;
+}
+
+CUT_PRIVATE void cut_LaunchUnit(struct cut_Slot *slot) {
     int r;
     int pipefd[2];
     r = pipe(pipefd);
     if (r == -1)
         cut_FatalExit("cannot establish communication pipe");
+    // neither spawned units nor forked ones should keep other read ends
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC) != -1 || cut_FatalExit("cannot set close-on-exec");
 
-    cut_pipeRead = pipefd[0];
-    cut_pipeWrite = pipefd[1];
-
-    int pid = getpid();
+    fflush(cut_output);
     int parentPid = getpid();
-    pid = fork();
+    int pid;
+    if (cut_zygotePid)
+        pid = cut_ZygoteUnit(slot, pipefd[1]);
+    else if (cut_arguments.spawn)
+        pid = cut_SpawnUnit(slot, pipefd[1]);
+    else
+        pid = fork();
     if (pid == -1)
         cut_FatalExit("cannot fork");
     if (!pid) {
-        r = prctl(PR_SET_PDEATHSIG, SIGTERM);
-        if (r == -1)
-            cut_FatalExit("cannot set child death signal");
-        if (getppid() != parentPid)
-            exit(cut_ERROR_EXIT);
-        close(cut_pipeRead) != -1 || cut_FatalExit("cannot close file");
+        close(pipefd[0]) != -1 || cut_FatalExit("cannot close file");
+        cut_RunLaunchedUnit(parentPid, pipefd[1], slot->batch, slot->batchSize);
+    }
+    // parent process only; the unit leads its own group so that the watchdog kills its helpers too
+    setpgid(pid, pid);
+    close(pipefd[1]) != -1 || cut_FatalExit("cannot close file");
+    fcntl(pipefd[0], F_SETFL, O_NONBLOCK) != -1 || cut_FatalExit("cannot set non-blocking pipe");
+    slot->pid = pid;
+    slot->pipeRead = pipefd[0];
+    slot->pidFd = cut_PidOpen(pid);
+}
 
-        if (cut_arguments.timeout) {
-            signal(SIGALRM, cut_SigAlrm);
-            alarm(cut_arguments.timeout);
+CUT_PRIVATE void cut_GuardHandler(int signal) {
+    cut_crashSignal = signal;
+    CUT_LONG_JUMP(cut_executionPoint);
+}
+
+CUT_PRIVATE void cut_TimeoutHandler(CUT_UNUSED(int signal)) {
+    // the signal sent just before the unit ended finds nothing to interrupt
+    if (!cut_guardActive)
+        return;
+    cut_guardActive = 0;
+    cut_Timeouted();
+    CUT_LONG_JUMP(cut_executionPoint);
+}
+
+CUT_PRIVATE void *cut_WatchdogMain(CUT_UNUSED(void *data)) {
+    pthread_mutex_lock(&cut_watchdogLock);
+    for (;;) {
+        if (!cut_guardDeadline) {
+            pthread_cond_wait(&cut_watchdogWake, &cut_watchdogLock);
+            continue;
+        }
+        int64_t left = cut_guardDeadline - cut_Now();
+        if (left <= 0) {
+            cut_guardDeadline = 0;
+            pthread_kill(cut_watchdogTarget, CUT_TIMEOUT_SIGNAL);
+            continue;
         }
-        cut_ExceptionBypass(testId, subtest);
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += left / 1000000 + (until.tv_nsec + left % 1000000 * 1000) / 1000000000;
+        until.tv_nsec = (until.tv_nsec + left % 1000000 * 1000) % 1000000000;
+        pthread_cond_timedwait(&cut_watchdogWake, &cut_watchdogLock, &until);
+    }
+    return NULL;
+}
 
-        close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
-        free(cut_unitTests.tests);
-        free(cut_arguments.match);
-        if (cut_arguments.output)
-            fclose(cut_output);
-        exit(cut_NORMAL_EXIT);
+CUT_PRIVATE void cut_StartWatchdog() {
+    // the handler of the timeout stays, a signal sent while the unit was ending may come late
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = cut_TimeoutHandler;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(CUT_TIMEOUT_SIGNAL, &action, NULL) != -1 || cut_FatalExit("cannot set timeout handler");
+
+    // the watchdog takes none of the signals meant for the process
+    sigset_t signals, previous;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attributes, cut_WatchdogMain, NULL) == 0 || cut_FatalExit("cannot start watchdog thread");
+    pthread_attr_destroy(&attributes);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    cut_watchdogStarted = 1;
+}
+
+CUT_PRIVATE void cut_GuardUnit(int testId, int subtest) {
+    if (!cut_alternateStack) {
+        // a stack overflow leaves no room for the handler on the usual stack
+        stack_t stack;
+        memset(&stack, 0, sizeof(stack));
+        stack.ss_size = SIGSTKSZ + 64 * 1024;
+        stack.ss_sp = cut_alternateStack = (char *)malloc(stack.ss_size);
+        if (!cut_alternateStack)
+            cut_FatalExit("cannot allocate alternate signal stack");
+        sigaltstack(&stack, NULL) != -1 || cut_FatalExit("cannot set alternate signal stack");
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = cut_GuardHandler;
+    // the handler never returns, the jump restores the signal mask of the unit
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < cut_GUARDED_SIGNALS; ++i)
+        sigaction(cut_guardedSignals[i], &action, &cut_guardedActions[i]);
+
+    cut_guardTimeout = cut_UnitTimeout(testId, subtest);
+    if (!cut_guardTimeout)
+        return;
+    if (!cut_watchdogStarted)
+        cut_StartWatchdog();
+    cut_watchdogTarget = pthread_self();
+    cut_RearmUnit();
+}
+
+CUT_PRIVATE void cut_RearmUnit() {
+    // the watchdog times the unit the runner runs itself, not units on threads
+    if (!cut_inProcess || !cut_guardTimeout)
+        return;
+    // the unit must not jump away holding the lock, a timeout due just now is postponed anyway
+    cut_guardActive = 0;
+    pthread_mutex_lock(&cut_watchdogLock);
+    cut_guardDeadline = cut_Now() + (int64_t)cut_guardTimeout * 1000;
+    pthread_cond_signal(&cut_watchdogWake);
+    pthread_mutex_unlock(&cut_watchdogLock);
+    cut_guardActive = 1;
+}
+
+CUT_PRIVATE void cut_SyncFile(FILE *file) {
+    fflush(file);
+    fsync(fileno(file));
+}
+
+CUT_PRIVATE void cut_ReleaseUnit() {
+    if (cut_guardTimeout) {
+        cut_guardActive = 0;
+        pthread_mutex_lock(&cut_watchdogLock);
+        cut_guardDeadline = 0;
+        pthread_mutex_unlock(&cut_watchdogLock);
+        cut_guardTimeout = 0;
     }
-    // parent process only
+    for (int i = 0; i < cut_GUARDED_SIGNALS; ++i)
+        sigaction(cut_guardedSignals[i], &cut_guardedActions[i], NULL);
+}
+
+CUT_PRIVATE uint64_t cut_ProcessEntries(uint64_t hash, const char *path) {
+    DIR *directory = opendir(path);
+    if (!directory)
+        return hash;
+    for (struct dirent *entry = readdir(directory); entry; entry = readdir(directory))
+        hash = cut_HashBytes(hash, entry->d_name, strlen(entry->d_name) + 1);
+    closedir(directory);
+    return hash;
+}
+
+// open files, threads and signal handlers of the runner which a unit must leave as they were
+CUT_PRIVATE uint64_t cut_ProcessFingerprint() {
+    // the watchdog belongs to the runner, the unit which happens to start it has not changed anything
+    if (!cut_watchdogStarted)
+        cut_StartWatchdog();
+    uint64_t hash = cut_ProcessEntries(14695981039346656037ULL, "/proc/self/fd");
+    hash = cut_ProcessEntries(hash, "/proc/self/task");
+    // handlers are compared by their addresses, flags and masks are left out
+    for (int signal = 1; signal < NSIG; ++signal) {
+        struct sigaction action;
+        if (sigaction(signal, NULL, &action) == -1)
+            continue;
+        uintptr_t handler = (action.sa_flags & SA_SIGINFO)
+            ? (uintptr_t)action.sa_sigaction : (uintptr_t)action.sa_handler;
+        hash = cut_HashBytes(hash, &handler, sizeof(handler));
+    }
+    return hash;
+}
+
+CUT_PRIVATE void cut_KillUnit(int pid) {
+    if (kill(-pid, SIGKILL) == -1)
+        kill(pid, SIGKILL);
+}
+
+CUT_PRIVATE void cut_SeparateIO() {
+    FILE **files[2] = {&cut_stdout, &cut_stderr};
+    for (int i = 0; i < 2; ++i) {
+        FILE *copy = tmpfile();
+        if (!copy)
+            cut_FatalExit("cannot open temporary file");
+        char buffer[4096];
+        off_t offset = 0;
+        int64_t r;
+        while ((r = pread(fileno(*files[i]), buffer, sizeof(buffer), offset)) > 0) {
+            fwrite(buffer, 1, (size_t)r, copy) == (size_t)r || cut_FatalExit("cannot copy output");
+            offset += r;
+        }
+        fflush(copy);
+        dup2(fileno(copy), i + 1) != -1 || cut_FatalExit("cannot redirect output");
+        fclose(*files[i]);
+        *files[i] = copy;
+    }
+}
+
+int cut_Branch(int first, int last, int *current) {
+    // forking a single thread of the runner would not make a unit
+    if (!cut_arguments.forkSubtests || *current || cut_unitThread)
+        return 0;
+    for (int subtest = first; subtest <= last; ++subtest) {
+        fflush(stdout);
+        fflush(stderr);
+        int pid = fork();
+        if (pid == -1)
+            cut_FatalExit("cannot fork");
+        if (!pid) {
+            setpgid(0, 0);
+            prctl(PR_SET_PDEATHSIG, SIGKILL) != -1 || cut_FatalExit("cannot set child death signal");
+            cut_SeparateIO();
+            cut_SendBranch(subtest, cut_UnitPid());
+            cut_branched = 1;
+            *current = subtest;
+            return 1;
+        }
+        int status = 0;
+        int r;
+        do {
+            r = waitpid(pid, &status, 0);
+        } while (r == -1 && errno == EINTR);
+        r != -1 || cut_FatalExit("cannot wait for subtest");
+        cut_SendStatus(WIFEXITED(status) ? WEXITSTATUS(status) : 0,
+                       WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    }
+    return 0;
+}
+
+CUT_PRIVATE void cut_DrainUnit(struct cut_Slot *slot) {
+    char buffer[4096];
+    for (;;) {
+        int64_t r = read(slot->pipeRead, buffer, sizeof(buffer));
+        if (r > 0) {
+            cut_SlotFeed(slot, buffer, (size_t)r);
+            continue;
+        }
+        if (r == -1 && errno == EINTR)
+            continue;
+        if (r == -1 && errno != EAGAIN)
+            cut_FatalExit("cannot read message");
+        // an exited unit cannot write anymore; whoever else keeps the pipe open is ignored
+        if (!r || slot->exited)
+            slot->eof = 1;
+        return;
+    }
+}
+
+CUT_PRIVATE void cut_ReapUnit(struct cut_Slot *slot, int options) {
     int status = 0;
-    close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
-    cut_PipeReader(result);
-    waitpid(pid, &status, 0) != -1 || cut_FatalExit("cannot wait for unit");
-    result->returnCode = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
-    result->signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
-    result->failed |= result->returnCode ||  result->signal;
-    close(cut_pipeRead) != -1 || cut_FatalExit("cannot close file");
+    struct rusage usage;
+    int r;
+    do {
+        r = wait4(slot->pid, &status, options, &usage);
+    } while (r == -1 && errno == EINTR);
+    r != -1 || cut_FatalExit("cannot wait for unit");
+    if (!r)
+        return;
+    slot->exited = 1;
+    // the peak of a batch cannot be told apart among its units
+    if (slot->batchSize == 1)
+        slot->result.memory = usage.ru_maxrss;
+    slot->result.returnCode = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+    slot->result.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    slot->result.failed |= slot->result.returnCode || slot->result.signal;
+}
+
+CUT_PRIVATE void cut_WaitForUnits(struct cut_Slot *slots, int count, int timeout) {
+    struct pollfd *fds = (struct pollfd *)malloc(2 * count * sizeof(struct pollfd));
+    struct cut_Slot **owners = (struct cut_Slot **)malloc(2 * count * sizeof(struct cut_Slot *));
+    if (!fds || !owners)
+        cut_FatalExit("cannot allocate memory for poll");
+
+    int size = 0;
+    for (int i = 0; i < count; ++i) {
+        if (slots[i].state != cut_SLOT_RUNNING)
+            continue;
+        if (!slots[i].eof) {
+            fds[size].fd = slots[i].pipeRead;
+            fds[size].events = POLLIN;
+            owners[size++] = &slots[i];
+        }
+        if (!slots[i].exited && slots[i].pidFd >= 0) {
+            fds[size].fd = slots[i].pidFd;
+            fds[size].events = POLLIN;
+            owners[size++] = &slots[i];
+        }
+    }
+
+    int r;
+    do {
+        r = poll(fds, size, timeout);
+    } while (r == -1 && errno == EINTR);
+    r != -1 || cut_FatalExit("cannot poll units");
+
+    for (int i = 0; r > 0 && i < size; ++i) {
+        struct cut_Slot *slot = owners[i];
+        if (!fds[i].revents)
+            continue;
+        if (fds[i].fd == slot->pipeRead)
+            cut_DrainUnit(slot);
+        else
+            cut_ReapUnit(slot, WNOHANG);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        struct cut_Slot *slot = &slots[i];
+        if (slot->state != cut_SLOT_RUNNING)
+            continue;
+        if (slot->eof && !slot->exited)
+            cut_ReapUnit(slot, slot->pidFd >= 0 ? WNOHANG : 0);
+        if (slot->exited && !slot->eof)
+            cut_DrainUnit(slot);
+        if (!slot->exited || !slot->eof)
+            continue;
+        close(slot->pipeRead) != -1 || cut_FatalExit("cannot close file");
+        if (slot->pidFd >= 0)
+            close(slot->pidFd) != -1 || cut_FatalExit("cannot close file");
+        slot->state = cut_SLOT_DONE;
+    }
+    free(fds);
+    free(owners);
 }
 
 CUT_PRIVATE int cut_ReadWholeFile(int fd, char **buffer, size_t *length) {
@@ -129,6 +926,113 @@ cleanup:
     return result;
 }
 
+CUT_PRIVATE int cut_MakeDirectory(const char *path) {
+    return mkdir(path, 0777) != -1 || errno == EEXIST;
+}
+
+CUT_PRIVATE char *cut_ImageBytes(char *image, size_t length, uintptr_t address, size_t size) {
+    const ElfW(Ehdr) *header = (const ElfW(Ehdr) *)image;
+    const ElfW(Shdr) *sections = (const ElfW(Shdr) *)(image + header->e_shoff);
+    for (int i = 0; i < header->e_shnum; ++i) {
+        const ElfW(Shdr) *section = &sections[i];
+        if (!(section->sh_flags & SHF_ALLOC) || section->sh_type == SHT_NOBITS)
+            continue;
+        if (address < section->sh_addr || address + size > section->sh_addr + section->sh_size)
+            continue;
+        if (section->sh_offset + section->sh_size > length)
+            return NULL;
+        return image + section->sh_offset + (address - section->sh_addr);
+    }
+    return NULL;
+}
+
+/* A key of a test is the hash of machine code of its function, found in the symbol table
+   of the executable, combined with the hash of everything else the executable loads.
+   Code of the tests is left out of the latter, so a test does not depend on the others.
+ */
+CUT_PRIVATE int cut_HashImage(char *image, size_t length, uint64_t *keys) {
+    const ElfW(Ehdr) *header = (const ElfW(Ehdr) *)image;
+    if (length < sizeof(*header) || memcmp(header->e_ident, ELFMAG, SELFMAG)
+        || header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) > length)
+    {
+        return 0;
+    }
+    const ElfW(Shdr) *sections = (const ElfW(Shdr) *)(image + header->e_shoff);
+    const ElfW(Shdr) *table = NULL;
+    for (int i = 0; i < header->e_shnum; ++i) {
+        if (sections[i].sh_type == SHT_SYMTAB)
+            table = &sections[i];
+    }
+    // stripped executables have no symbols of the tests
+    if (!table || table->sh_link >= header->e_shnum
+        || table->sh_offset + table->sh_size > length
+        || sections[table->sh_link].sh_offset + sections[table->sh_link].sh_size > length)
+    {
+        return 0;
+    }
+    const ElfW(Sym) *symbols = (const ElfW(Sym) *)(image + table->sh_offset);
+    size_t symbolCount = table->sh_size / sizeof(ElfW(Sym));
+    const char *names = image + sections[table->sh_link].sh_offset;
+    size_t namesLength = sections[table->sh_link].sh_size;
+
+    // position independent executables are loaded at an arbitrary address
+    uintptr_t bias = 0;
+    int found = 0;
+    for (size_t i = 0; i < symbolCount && !found; ++i) {
+        if (ELF64_ST_TYPE(symbols[i].st_info) != STT_FUNC || symbols[i].st_name >= namesLength)
+            continue;
+        if (!strcmp(names + symbols[i].st_name, "cut_Register")) {
+            bias = (uintptr_t)&cut_Register - symbols[i].st_value;
+            found = 1;
+        }
+    }
+    if (!found)
+        return 0;
+
+    for (int t = 0; t < cut_unitTests.size; ++t) {
+        uintptr_t address = (uintptr_t)cut_unitTests.tests[t].instance - bias;
+        char *code = NULL;
+        size_t size = 0;
+        for (size_t i = 0; i < symbolCount && !code; ++i) {
+            if (ELF64_ST_TYPE(symbols[i].st_info) != STT_FUNC || symbols[i].st_value != address)
+                continue;
+            size = symbols[i].st_size;
+            code = cut_ImageBytes(image, length, address, size);
+        }
+        if (!code)
+            return 0;
+        keys[t] = cut_HashBytes(14695981039346656037ULL, code, size);
+        memset(code, 0, size);
+    }
+
+    // build ids and other notes differ on every change of the executable
+    uint64_t other = 14695981039346656037ULL;
+    for (int i = 0; i < header->e_shnum; ++i) {
+        const ElfW(Shdr) *section = &sections[i];
+        if (!(section->sh_flags & SHF_ALLOC) || section->sh_type == SHT_NOBITS
+            || section->sh_type == SHT_NOTE || section->sh_offset + section->sh_size > length)
+        {
+            continue;
+        }
+        other = cut_HashBytes(other, image + section->sh_offset, section->sh_size);
+    }
+    for (int t = 0; t < cut_unitTests.size; ++t)
+        keys[t] = cut_HashMix(cut_HashBytes(keys[t], &other, sizeof(other)));
+    return 1;
+}
+
+CUT_PRIVATE int cut_HashTests(uint64_t *keys) {
+    int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+    char *image = NULL;
+    size_t length = 0;
+    int result = cut_ReadWholeFile(fd, &image, &length) && cut_HashImage(image, length, keys);
+    close(fd);
+    free(image);
+    return result;
+}
+
 int cut_File(FILE *f, const char *content) {
     int result = 0;
     size_t length = strlen(content);
@@ -176,6 +1080,63 @@ cleanup:
     return result;
 }
 
+// the linker replaces the binary by a new file, so the directory of the binary is watched instead
+CUT_PRIVATE void cut_WaitForChange(const char *self) {
+    int watcher = inotify_init1(IN_CLOEXEC);
+    if (watcher == -1)
+        cut_FatalExit("cannot watch for changes");
+    char *directory = (char *)malloc(strlen(self) + 1);
+    if (!directory)
+        cut_FatalExit("cannot allocate memory for watching");
+    strcpy(directory, self);
+    char *base = strrchr(directory, '/');
+    *base++ = '\0';
+    int selfWatch = inotify_add_watch(watcher, *directory ? directory : "/", IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (selfWatch == -1)
+        cut_FatalExit("cannot watch for changes");
+    int anyFile = 0;
+    for (int i = 0; i < cut_arguments.watchDirCount; ++i) {
+        int watch = inotify_add_watch(watcher, cut_arguments.watchDirs[i], IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+        if (watch == -1)
+            cut_ErrorExit("cannot watch directory %s", cut_arguments.watchDirs[i]);
+        anyFile |= watch == selfWatch;
+    }
+
+    union {
+        struct inotify_event event;
+        char data[4096];
+    } buffer;
+    struct pollfd events = {watcher, POLLIN, 0};
+    // the binary may have been relinked during the run or the summary, before the watch was set
+    int changed = cut_ChangeStamp(0, self) != cut_watchedStamp;
+    // a build writes many files, the run starts once they settle down
+    while (!changed || poll(&events, 1, CUT_WATCH_SETTLE) > 0) {
+        ssize_t length = read(watcher, buffer.data, sizeof(buffer.data));
+        if (length == -1 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            cut_FatalExit("cannot watch for changes");
+        for (char *current = buffer.data; current < buffer.data + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)current;
+            if (anyFile || event->wd != selfWatch || (event->len && !strcmp(event->name, base)))
+                changed = 1;
+            current += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    close(watcher);
+    free(directory);
+}
+
+CUT_PRIVATE void cut_Restart(char **argv) {
+    for (;;) {
+        cut_WaitForChange(cut_watchedBinary);
+        execv(cut_watchedBinary, argv);
+        // the binary may be half-written or gone while the build goes on
+        fprintf(stderr, "Cannot run %s again, waiting for the next change.\n", cut_watchedBinary);
+        cut_watchedStamp = cut_ChangeStamp(0, cut_watchedBinary);
+    }
+}
+
 CUT_PRIVATE int cut_PrintColorized(enum cut_Colors color, const char *text) {
     const char *prefix;
     const char *suffix = "\x1B[0m";
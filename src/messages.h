@@ -49,7 +49,7 @@ CUT_PRIVATE void cut_ResetLocalMessage() {
 }
 
 CUT_PRIVATE int cut_SendLocalMessage(struct cut_Fragment *message) {
-    if (!cut_arguments.noFork)
+    if (!cut_inProcess)
         return cut_SendMessage(message);
     if (message->serializedLength + cut_localMessageSize > CUT_MAX_LOCAL_MESSAGE_LENGTH)
         return 0;
@@ -111,7 +111,7 @@ void cut_Stop(const char *text, const char *file, size_t line) {
 
     cut_SendLocalMessage(&message) || cut_FatalExit("cannot send stop:message");
     cut_FragmentClean(&message);
-    longjmp(cut_executionPoint, 1);
+    CUT_LONG_JUMP(cut_executionPoint);
 }
 
 void cut_Check(const char *text, const char *file, size_t line) {
@@ -161,6 +161,69 @@ void cut_Subtest(int number, const char *name) {
     cut_FragmentClean(&message);
 }
 
+CUT_PRIVATE void cut_SendBranch(int subtest, int pid) {
+    struct cut_Fragment message;
+    cut_FragmentInit(&message, cut_MESSAGE_BRANCH);
+    int *pSubtest = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    int *pPid = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    if (!pSubtest || !pPid)
+        cut_FatalExit("cannot insert branch:fragment");
+    *pSubtest = subtest;
+    *pPid = pid;
+    cut_FragmentSerialize(&message) || cut_FatalExit("cannot serialize branch:fragment");
+    cut_SendLocalMessage(&message) || cut_FatalExit("cannot send branch:message");
+    cut_FragmentClean(&message);
+}
+
+CUT_PRIVATE void cut_SendStatus(int returnCode, int signal) {
+    struct cut_Fragment message;
+    cut_FragmentInit(&message, cut_MESSAGE_STATUS);
+    int *pReturnCode = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    int *pSignal = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    if (!pReturnCode || !pSignal)
+        cut_FatalExit("cannot insert status:fragment");
+    *pReturnCode = returnCode;
+    *pSignal = signal;
+    cut_FragmentSerialize(&message) || cut_FatalExit("cannot serialize status:fragment");
+    cut_SendLocalMessage(&message) || cut_FatalExit("cannot send status:message");
+    cut_FragmentClean(&message);
+}
+
+CUT_PRIVATE void cut_SendUnit(int testId, int subtest) {
+    struct cut_Fragment message;
+    cut_FragmentInit(&message, cut_MESSAGE_UNIT);
+    int *pTestId = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    int *pSubtest = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    if (!pTestId || !pSubtest)
+        cut_FatalExit("cannot insert unit:fragment");
+    *pTestId = testId;
+    *pSubtest = subtest;
+    cut_FragmentSerialize(&message) || cut_FatalExit("cannot serialize unit:fragment");
+    cut_SendLocalMessage(&message) || cut_FatalExit("cannot send unit:message");
+    cut_FragmentClean(&message);
+}
+
+void cut_Heartbeat(int done) {
+    cut_heartbeatDone = done < 0 ? cut_heartbeatDone + 1 : done;
+    int64_t now = cut_Now();
+    if (cut_heartbeatSent && now - cut_heartbeatSent < CUT_HEARTBEAT_PERIOD)
+        return;
+    cut_heartbeatSent = now;
+    cut_RearmUnit();
+    // the runner reads messages of a unit run by itself only once the unit ends
+    if (cut_inProcess)
+        return;
+    struct cut_Fragment message;
+    cut_FragmentInit(&message, cut_MESSAGE_HEARTBEAT);
+    int *pDone = (int *)cut_FragmentReserve(&message, sizeof(int), NULL);
+    if (!pDone)
+        cut_FatalExit("cannot insert heartbeat:fragment");
+    *pDone = cut_heartbeatDone;
+    cut_FragmentSerialize(&message) || cut_FatalExit("cannot serialize heartbeat:fragment");
+    cut_SendLocalMessage(&message) || cut_FatalExit("cannot send heartbeat:message");
+    cut_FragmentClean(&message);
+}
+
 CUT_PRIVATE int cut_ReadLocalMessage(struct cut_Fragment *message) {
     if (!cut_localMessageSize)
         return cut_ReadMessage(message);
@@ -194,72 +257,85 @@ CUT_PRIVATE int cut_ReadLocalMessage(struct cut_Fragment *message) {
     return toRead != -1;
 }
 
+CUT_PRIVATE int cut_ProcessMessage(struct cut_Fragment *message, struct cut_UnitResult *result) {
+    int repeat = 0;
+    switch (message->id) {
+    case cut_MESSAGE_SUBTEST:
+        message->sliceCount == 2 || cut_FatalExit("invalid debug:message format");
+        cut_SetSubtestName(
+            result,
+            *(int *)cut_FragmentGet(message, 0, NULL),
+            cut_FragmentGet(message, 1, NULL)
+        ) || cut_FatalExit("cannot set subtest name");
+        repeat = 1;
+        break;
+    case cut_MESSAGE_DEBUG:
+        message->sliceCount == 3 || cut_FatalExit("invalid debug:message format");
+        cut_AddInfo(
+            &result->debug,
+            *(size_t *)cut_FragmentGet(message, 0, NULL),
+            cut_FragmentGet(message, 1, NULL),
+            cut_FragmentGet(message, 2, NULL)
+        ) || cut_FatalExit("cannot add debug");
+        repeat = 1;
+        break;
+    case cut_MESSAGE_OK:
+        message->sliceCount == 1 || cut_FatalExit("invalid ok:message format");
+        result->subtests = *(int *)cut_FragmentGet(message, 0, NULL);
+        break;
+    case cut_MESSAGE_FAIL:
+        message->sliceCount == 3 || cut_FatalExit("invalid fail:message format");
+        cut_SetFailResult(
+            result,
+            *(size_t *)cut_FragmentGet(message, 0, NULL),
+            cut_FragmentGet(message, 1, NULL),
+            cut_FragmentGet(message, 2, NULL)
+        ) || cut_FatalExit("cannot set fail result");
+        break;
+    case cut_MESSAGE_EXCEPTION:
+        message->sliceCount == 2 || cut_FatalExit("invalid exception:message format");
+        cut_SetExceptionResult(
+            result,
+            cut_FragmentGet(message, 0, NULL),
+            cut_FragmentGet(message, 1, NULL)
+        ) || cut_FatalExit("cannot set exception result");
+        break;
+    case cut_MESSAGE_HEARTBEAT:
+        repeat = 1;
+        break;
+    case cut_MESSAGE_TIMEOUT:
+        result->timeouted = 1;
+        result->failed = 1;
+        break;
+    case cut_MESSAGE_STATUS:
+        message->sliceCount == 2 || cut_FatalExit("invalid status:message format");
+        result->returnCode = *(int *)cut_FragmentGet(message, 0, NULL);
+        result->signal = *(int *)cut_FragmentGet(message, 1, NULL);
+        result->failed |= result->returnCode || result->signal;
+        break;
+    case cut_MESSAGE_CHECK:
+        message->sliceCount == 3 || cut_FatalExit("invalid check:message format");
+        cut_AddInfo(
+            &result->check,
+            *(size_t *)cut_FragmentGet(message, 0, NULL),
+            cut_FragmentGet(message, 1, NULL),
+            cut_FragmentGet(message, 2, NULL)
+        ) || cut_FatalExit("cannot add check");
+        result->failed = 1;
+        repeat = 1;
+        break;
+    }
+    return repeat;
+}
+
 CUT_PRIVATE void *cut_PipeReader(struct cut_UnitResult *result) {
     int repeat;
     do {
-        repeat = 0;
         struct cut_Fragment message;
         cut_FragmentInit(&message, cut_NO_TYPE);
         cut_ReadLocalMessage(&message) || cut_FatalExit("cannot read message");
         cut_FragmentDeserialize(&message) || cut_FatalExit("cannot deserialize message");
-
-        switch (message.id) {
-        case cut_MESSAGE_SUBTEST:
-            message.sliceCount == 2 || cut_FatalExit("invalid debug:message format");
-            cut_SetSubtestName(
-                result,
-                *(int *)cut_FragmentGet(&message, 0, NULL),
-                cut_FragmentGet(&message, 1, NULL)
-            ) || cut_FatalExit("cannot set subtest name");
-            repeat = 1;
-            break;
-        case cut_MESSAGE_DEBUG:
-            message.sliceCount == 3 || cut_FatalExit("invalid debug:message format");
-            cut_AddInfo(
-                &result->debug,
-                *(size_t *)cut_FragmentGet(&message, 0, NULL),
-                cut_FragmentGet(&message, 1, NULL),
-                cut_FragmentGet(&message, 2, NULL)
-            ) || cut_FatalExit("cannot add debug");
-            repeat = 1;
-            break;
-        case cut_MESSAGE_OK:
-            message.sliceCount == 1 || cut_FatalExit("invalid ok:message format");
-            result->subtests = *(int *)cut_FragmentGet(&message, 0, NULL);
-            break;
-        case cut_MESSAGE_FAIL:
-            message.sliceCount == 3 || cut_FatalExit("invalid fail:message format");
-            cut_SetFailResult(
-                result,
-                *(size_t *)cut_FragmentGet(&message, 0, NULL),
-                cut_FragmentGet(&message, 1, NULL),
-                cut_FragmentGet(&message, 2, NULL)
-            ) || cut_FatalExit("cannot set fail result");
-            break;
-        case cut_MESSAGE_EXCEPTION:
-            message.sliceCount == 2 || cut_FatalExit("invalid exception:message format");
-            cut_SetExceptionResult(
-                result,
-                cut_FragmentGet(&message, 0, NULL),
-                cut_FragmentGet(&message, 1, NULL)
-            ) || cut_FatalExit("cannot set exception result");
-            break;
-        case cut_MESSAGE_TIMEOUT:
-            result->timeouted = 1;
-            result->failed = 1;
-            break;
-        case cut_MESSAGE_CHECK:
-            message.sliceCount == 3 || cut_FatalExit("invalid check:message format");
-            cut_AddInfo(
-                &result->check,
-                *(size_t *)cut_FragmentGet(&message, 0, NULL),
-                cut_FragmentGet(&message, 1, NULL),
-                cut_FragmentGet(&message, 2, NULL)
-            ) || cut_FatalExit("cannot add check");
-            result->failed = 1;
-            repeat = 1;
-            break;
-        }
+        repeat = cut_ProcessMessage(&message, result);
         cut_FragmentClean(&message);
     } while (repeat);
     return NULL;
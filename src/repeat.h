@@ -0,0 +1,206 @@
+#ifndef CUT_REPEAT_H
+#define CUT_REPEAT_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+/* Repeated units are enqueued several times, so that copies of the same unit
+   run in parallel. Every run is aggregated into statistics of the unit and
+   the unit is finished after its last run with the first failed run (or the
+   first run at all) as its result.
+ */
+
+CUT_PRIVATE int cut_RepeatCopies(int testId, int subtest) {
+    if (!cut_arguments.repeat)
+        return 1;
+    struct cut_UnitStats *stats = &cut_schedule.tests[testId].stats[subtest];
+    int remaining = cut_arguments.repeat - stats->scheduled;
+    int copies = remaining < cut_schedule.slotCount ? remaining : cut_schedule.slotCount;
+    // next copies are added one by one as the runs finish
+    if (stats->scheduled)
+        copies = remaining > 0;
+    stats->scheduled += copies;
+    return copies;
+}
+
+CUT_PRIVATE void cut_FailureText(const struct cut_UnitResult *result, char *text, size_t size) {
+    if (result->timeouted)
+        snprintf(text, size, "timeouted");
+    else if (result->statement && result->file)
+        snprintf(text, size, "assert '%s' (%s:%d)", result->statement, cut_ShortPath(result->file), result->line);
+    else if (result->exceptionType && result->exceptionMessage)
+        snprintf(text, size, "exception %s: %s", result->exceptionType, result->exceptionMessage);
+    else if (result->signal)
+        snprintf(text, size, "signal: %s", cut_Signal(result->signal));
+    else if (result->check)
+        snprintf(text, size, "check '%s' (%s:%d)", result->check->message,
+                 cut_ShortPath(result->check->file), result->check->line);
+    else if (result->returnCode)
+        snprintf(text, size, "return code: %s", cut_ReturnCode(result->returnCode));
+    else if (result->statement)
+        snprintf(text, size, "%s", result->statement);
+    else
+        snprintf(text, size, "failed");
+}
+
+CUT_PRIVATE void cut_AddFailure(struct cut_UnitStats *stats, const struct cut_UnitResult *result) {
+    char text[512];
+    cut_FailureText(result, text, sizeof(text));
+    for (int i = 0; i < stats->kindCount; ++i) {
+        if (!strcmp(stats->kinds[i].text, text)) {
+            ++stats->kinds[i].count;
+            return;
+        }
+    }
+    stats->kinds = (struct cut_FailureKind *)realloc(stats->kinds,
+        sizeof(struct cut_FailureKind) * (stats->kindCount + 1));
+    if (!stats->kinds)
+        cut_FatalExit("cannot allocate memory for statistics");
+    struct cut_FailureKind *kind = &stats->kinds[stats->kindCount++];
+    kind->text = (char *)malloc(strlen(text) + 1);
+    if (!kind->text)
+        cut_FatalExit("cannot allocate memory for statistics");
+    strcpy(kind->text, text);
+    kind->count = 1;
+    kind->first = stats->runs;
+}
+
+CUT_PRIVATE int cut_RepeatUnit(int testId, int subtest, struct cut_UnitResult *result) {
+    if (!cut_arguments.repeat)
+        return 0;
+    struct cut_UnitStats *stats = &cut_schedule.tests[testId].stats[subtest];
+    // copies which were running when another one failed with --until-fail come after the unit is done
+    if (cut_schedule.tests[testId].finished[subtest]) {
+        cut_CleanMemory(result);
+        memset(result, 0, sizeof(*result));
+        return 1;
+    }
+    if (!stats->runs || result->duration < stats->fastest)
+        stats->fastest = result->duration;
+    if (!stats->runs || result->duration > stats->slowest)
+        stats->slowest = result->duration;
+    if (!stats->samples) {
+        // the number of runs is known up front unless --until-fail has no --repeat limit
+        stats->sampleCapacity = cut_arguments.repeat < INT_MAX ? cut_arguments.repeat : CUT_REPEAT_SAMPLES;
+        stats->samples = (int64_t *)malloc(sizeof(int64_t) * stats->sampleCapacity);
+        if (!stats->samples)
+            cut_FatalExit("cannot allocate memory for statistics");
+    }
+    if (stats->sampleCount < stats->sampleCapacity) {
+        stats->samples[stats->sampleCount++] = result->duration;
+    } else {
+        // reservoir sampling, every run so far has the same chance to be in the sample
+        uint64_t slot = cut_HashMix((uint64_t)stats->runs) % (uint64_t)(stats->runs + 1);
+        if (slot < (uint64_t)stats->sampleCapacity)
+            stats->samples[slot] = result->duration;
+    }
+    ++stats->runs;
+    if (!stats->title && result->name) {
+        stats->title = (char *)malloc(strlen(result->name) + 1);
+        if (!stats->title)
+            cut_FatalExit("cannot allocate memory for statistics");
+        strcpy(stats->title, result->name);
+    }
+    stats->number = result->number;
+    if (result->failed) {
+        ++stats->failures;
+        if (!stats->firstFailure)
+            stats->firstFailure = stats->runs;
+        cut_AddFailure(stats, result);
+    }
+
+    // the first failure describes the unit best
+    if (!stats->kept || (result->failed && !stats->result.failed)) {
+        if (stats->kept)
+            cut_CleanMemory(&stats->result);
+        stats->result = *result;
+        stats->kept = 1;
+    } else {
+        cut_CleanMemory(result);
+    }
+    memset(result, 0, sizeof(*result));
+
+    if (stats->runs < cut_arguments.repeat && !(cut_arguments.untilFail && stats->failures)) {
+        if (stats->scheduled < cut_arguments.repeat)
+            cut_EnqueueUnit(testId, subtest, 0, 0);
+        return 1;
+    }
+    *result = stats->result;
+    memset(&stats->result, 0, sizeof(stats->result));
+    stats->kept = 0;
+    return 0;
+}
+
+CUT_PRIVATE void cut_FlushRepeats() {
+    if (!cut_arguments.repeat)
+        return;
+    // units interrupted by a stopped run are finished with what they have done so far
+    for (int i = 0; i < cut_unitTests.size; ++i) {
+        struct cut_TestProgress *progress = &cut_schedule.tests[i];
+        for (int subtest = 0; subtest < progress->capacity; ++subtest) {
+            struct cut_UnitStats *stats = &progress->stats[subtest];
+            if (!stats->kept || progress->finished[subtest])
+                continue;
+            progress->results[subtest] = stats->result;
+            progress->finished[subtest] = 1;
+            if (stats->result.failed)
+                ++progress->failed;
+            memset(&stats->result, 0, sizeof(stats->result));
+            stats->kept = 0;
+        }
+    }
+}
+
+CUT_PRIVATE void cut_PrintRepeats() {
+    if (!cut_arguments.repeat)
+        return;
+    fprintf(cut_output, "\nFlakiness:\n");
+    for (int i = 0; i < cut_unitTests.size; ++i) {
+        const struct cut_TestProgress *progress = &cut_schedule.tests[i];
+        for (int subtest = 0; subtest < progress->capacity && progress->stats; ++subtest) {
+            struct cut_UnitStats *stats = &progress->stats[subtest];
+            if (!stats->runs)
+                continue;
+            fprintf(cut_output, "  [%3i] %s", progress->number, cut_unitTests.tests[i].name);
+            if (subtest && stats->title && stats->number)
+                fprintf(cut_output, " / %s #%d", stats->title, stats->number);
+            else if (subtest && stats->title)
+                fprintf(cut_output, " / %s", stats->title);
+            else if (subtest)
+                fprintf(cut_output, " / #%d", subtest);
+            fprintf(cut_output, ": %d runs, %d failed (%.1f %%)",
+                    stats->runs, stats->failures, 100.0 * stats->failures / stats->runs);
+            if (stats->failures)
+                fprintf(cut_output, ", first at run %d", stats->firstFailure);
+            fprintf(cut_output, "\n");
+            // timing differs run to run, it goes along with the other statistics
+            if (cut_arguments.stats) {
+                qsort(stats->samples, stats->sampleCount, sizeof(int64_t), cut_DurationComparator);
+                fprintf(cut_output, "        time: min %.3f ms, median %.3f ms, p90 %.3f ms, max %.3f ms"
+                        " (percentiles of %d run%s)\n",
+                        stats->fastest / 1000.0,
+                        stats->samples[stats->sampleCount / 2] / 1000.0,
+                        stats->samples[stats->sampleCount * 9 / 10] / 1000.0,
+                        stats->slowest / 1000.0,
+                        stats->sampleCount, stats->sampleCount == 1 ? "" : "s");
+            }
+            for (int k = 0; k < stats->kindCount; ++k) {
+                fprintf(cut_output, "        %dx %s (first at run %d)\n",
+                        stats->kinds[k].count, stats->kinds[k].text, stats->kinds[k].first);
+            }
+        }
+    }
+}
+
+CUT_PRIVATE void cut_CleanStats(struct cut_UnitStats *stats) {
+    if (stats->kept)
+        cut_CleanMemory(&stats->result);
+    for (int k = 0; k < stats->kindCount; ++k)
+        free(stats->kinds[k].text);
+    free(stats->kinds);
+    free(stats->samples);
+    free(stats->title);
+}
+
+#endif // CUT_REPEAT_H
@@ -0,0 +1,189 @@
+#ifndef CUT_RERUN_H
+#define CUT_RERUN_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+/* The record of the last run keeps one line per unit:
+     <test name> <subtest> OK|FAIL
+   Units which were not run keep their previous outcome.
+ */
+
+CUT_PRIVATE struct cut_LastRunEntry *cut_FindLastRun(const char *name, int subtest) {
+    int found;
+    int position = cut_RecordPosition(cut_lastRun.entries, cut_lastRun.size, sizeof(struct cut_LastRunEntry),
+                                      name, subtest, &found);
+    return found ? &cut_lastRun.entries[position] : NULL;
+}
+
+CUT_PRIVATE struct cut_LastRunEntry *cut_AddLastRun(const char *name, int subtest) {
+    return (struct cut_LastRunEntry *)cut_InsertRecord((void **)&cut_lastRun.entries, &cut_lastRun.size,
+        &cut_lastRun.capacity, sizeof(struct cut_LastRunEntry), name, subtest);
+}
+
+CUT_PRIVATE void cut_LoadLastRun() {
+    const char *path = cut_arguments.lastRun;
+    if (cut_arguments.noLastRun) {
+        if (cut_arguments.rerunFailed || cut_arguments.watch)
+            cut_ErrorExit("option --no-last-run cannot be used with --rerun-failed or --watch");
+        return;
+    }
+    cut_lastRun.file = (char *)malloc(strlen(path ? path : cut_arguments.selfName) + 10);
+    if (!cut_lastRun.file)
+        cut_FatalExit("cannot allocate memory for record of the last run");
+    if (path)
+        strcpy(cut_lastRun.file, path);
+    else
+        sprintf(cut_lastRun.file, "%s.last-run", cut_arguments.selfName);
+
+    FILE *file = fopen(cut_lastRun.file, "r");
+    if (!file) {
+        if (cut_arguments.rerunFailed)
+            cut_ErrorExit("cannot read record of the last run from %s", cut_lastRun.file);
+        return;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        if (*line == '#')
+            continue;
+        char *name = strtok(line, " \t\r\n");
+        char *subtest = strtok(NULL, " \t\r\n");
+        char *outcome = strtok(NULL, " \t\r\n");
+        if (!name || !subtest || !outcome)
+            continue;
+        struct cut_LastRunEntry *entry = cut_AddLastRun(name, atoi(subtest));
+        entry->failed = !strcmp(outcome, "FAIL");
+        // the outcome changes during the run, the selection must not
+        entry->rerun = entry->failed;
+        entry->known = 1;
+        cut_lastRun.failed += entry->failed;
+    }
+    fclose(file);
+}
+
+CUT_PRIVATE void cut_SaveLastRun() {
+    if (!cut_lastRun.file)
+        return;
+    size_t length = strlen(cut_lastRun.file);
+    char *temporary = (char *)malloc(length + 5);
+    if (!temporary)
+        cut_FatalExit("cannot allocate memory for record of the last run");
+    sprintf(temporary, "%s.tmp", cut_lastRun.file);
+    // a run stopped while writing must not leave a truncated record for --rerun-failed
+    FILE *file = fopen(temporary, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write record of the last run to %s.\n", cut_lastRun.file);
+        free(temporary);
+        return;
+    }
+    fprintf(file, "# CUT last run 1\n");
+    for (int i = 0; i < cut_lastRun.size; ++i) {
+        const struct cut_LastRunEntry *entry = &cut_lastRun.entries[i];
+        fprintf(file, "%s %d %s\n", entry->record.name, entry->record.subtest, entry->failed ? "FAIL" : "OK");
+    }
+    if (fclose(file) == EOF || rename(temporary, cut_lastRun.file) == -1) {
+        fprintf(stderr, "Cannot write record of the last run to %s.\n", cut_lastRun.file);
+        remove(temporary);
+    }
+    free(temporary);
+}
+
+CUT_PRIVATE int cut_RerunUnit(int testId, int subtest) {
+    const struct cut_LastRunEntry *entry = cut_FindLastRun(cut_unitTests.tests[testId].name, subtest);
+    return entry && entry->rerun;
+}
+
+CUT_PRIVATE int cut_RerunTest(int testId) {
+    const char *name = cut_unitTests.tests[testId].name;
+    int found;
+    for (int i = cut_RecordPosition(cut_lastRun.entries, cut_lastRun.size, sizeof(struct cut_LastRunEntry),
+                                    name, 0, &found);
+         i < cut_lastRun.size && !strcmp(cut_lastRun.entries[i].record.name, name); ++i)
+    {
+        if (cut_lastRun.entries[i].rerun)
+            return 1;
+    }
+    return 0;
+}
+
+CUT_PRIVATE void cut_EnqueueRerun(int testId) {
+    struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+    const char *name = cut_unitTests.tests[testId].name;
+    int found;
+    for (int i = cut_RecordPosition(cut_lastRun.entries, cut_lastRun.size, sizeof(struct cut_LastRunEntry),
+                                    name, 0, &found);
+         i < cut_lastRun.size && !strcmp(cut_lastRun.entries[i].record.name, name); ++i)
+    {
+        const struct cut_LastRunEntry *entry = &cut_lastRun.entries[i];
+        if (!entry->rerun)
+            continue;
+        cut_ReserveResults(progress, entry->record.subtest);
+        if (entry->record.subtest > progress->subtests)
+            progress->subtests = entry->record.subtest;
+        cut_EnqueueUnit(testId, entry->record.subtest, 0, 0);
+    }
+}
+
+CUT_PRIVATE void cut_RecordOutcome(int testId, int subtest, const struct cut_UnitResult *result) {
+    if (!cut_lastRun.file || result->cached)
+        return;
+    struct cut_LastRunEntry *entry = cut_AddLastRun(cut_unitTests.tests[testId].name, subtest);
+    entry->failed = result->failed;
+    entry->recorded = 1;
+}
+
+CUT_PRIVATE void cut_FailedFirst(struct cut_UnitQueue *queue) {
+    // the order of units is kept otherwise, among the failed ones as well as among the rest
+    struct cut_UnitId *units = (struct cut_UnitId *)malloc(sizeof(struct cut_UnitId) * (queue->size + 1));
+    if (!units)
+        cut_FatalExit("cannot allocate memory for queue");
+    int count = 0;
+    for (int failed = 1; failed >= 0; --failed) {
+        for (int i = queue->head; i < queue->size; ++i) {
+            if (cut_RerunTest(queue->units[i].testId) == failed)
+                units[count++] = queue->units[i];
+        }
+    }
+    memcpy(queue->units + queue->head, units, sizeof(struct cut_UnitId) * count);
+    free(units);
+}
+
+CUT_PRIVATE void cut_PrintChanges() {
+    fprintf(cut_output, "\nChanges since the last run:\n");
+    int changes = 0;
+    for (int testId = 0; testId < cut_unitTests.size; ++testId) {
+        const char *name = cut_unitTests.tests[testId].name;
+        int found;
+        for (int i = cut_RecordPosition(cut_lastRun.entries, cut_lastRun.size, sizeof(struct cut_LastRunEntry),
+                                        name, 0, &found);
+             i < cut_lastRun.size && !strcmp(cut_lastRun.entries[i].record.name, name); ++i)
+        {
+            const struct cut_LastRunEntry *entry = &cut_lastRun.entries[i];
+            if (!entry->known || !entry->recorded || entry->rerun == entry->failed)
+                continue;
+            fprintf(cut_output, "  %s [%3i] %s", entry->failed ? "broken:" : "fixed: ",
+                    cut_schedule.tests[testId].number, name);
+            if (entry->record.subtest)
+                fprintf(cut_output, " / #%d", entry->record.subtest);
+            fprintf(cut_output, "\n");
+            ++changes;
+        }
+    }
+    if (!changes)
+        fprintf(cut_output, "  none\n");
+}
+
+CUT_PRIVATE void cut_CleanLastRun() {
+    for (int i = 0; i < cut_lastRun.size; ++i)
+        free(cut_lastRun.entries[i].record.name);
+    free(cut_lastRun.entries);
+    free(cut_lastRun.file);
+    cut_lastRun.entries = NULL;
+    cut_lastRun.file = NULL;
+    cut_lastRun.size = 0;
+    cut_lastRun.capacity = 0;
+    cut_lastRun.failed = 0;
+}
+
+#endif // CUT_RERUN_H
@@ -0,0 +1,930 @@
+#ifndef CUT_SCHEDULER_H
+#define CUT_SCHEDULER_H
+
+#ifndef CUT_MAIN
+#error "cannot be standalone"
+#endif
+
+CUT_PRIVATE const char *cut_EmergencyLog(int pid) {
+    static char name[32];
+    if (!pid)
+        return "cut.log";
+    sprintf(name, "cut-%d.log", pid);
+    return name;
+}
+
+CUT_PRIVATE void cut_ReadEmergencyLog(int pid, struct cut_UnitResult *result) {
+    const char *name = cut_EmergencyLog(pid);
+    FILE *emergencyLog = fopen(name, "r");
+    if (!emergencyLog)
+        return;
+    char buffer[512] = {0,};
+    fread(buffer, 511, 1, emergencyLog);
+    if (*buffer) {
+        free(result->statement);
+        result->statement = (char *)malloc(strlen(buffer) + 1);
+        if (result->statement)
+            strcpy(result->statement, buffer);
+    }
+    fclose(emergencyLog);
+    remove(name);
+}
+
+CUT_PRIVATE int cut_ThreadTest(int testId) {
+    return cut_schedule.threadCount && cut_unitTests.tests[testId].threadSafe;
+}
+
+CUT_PRIVATE void cut_PrivateDir(char *path, size_t size, int testId, int subtest, int pid, int index) {
+    snprintf(path, size, "%s/%s.%d-%d.%d", cut_arguments.privateRoot,
+             cut_unitTests.tests[testId].name, subtest, pid, index);
+}
+
+CUT_PRIVATE void cut_LeavePrivateDir(const struct cut_Slot *slot, const struct cut_UnitResult *result) {
+    // units run by the runner itself have no directory of their own
+    if (!cut_arguments.privateRoot || !slot->pid)
+        return;
+    if (result->failed && cut_arguments.keepPrivateDir) {
+        ++cut_schedule.keptDirs;
+        return;
+    }
+    char path[4096];
+    cut_PrivateDir(path, sizeof(path), slot->unit.testId, slot->unit.subtest, slot->pid, slot->batchDone - 1);
+    cut_RemoveTree(path);
+}
+
+CUT_PRIVATE void cut_RemovePrivateRoot() {
+    if (!cut_arguments.privateDir || cut_schedule.keptDirs)
+        return;
+    cut_RemoveTree(cut_arguments.privateRoot);
+}
+
+CUT_PRIVATE void cut_PushUnit(int testId, int subtest, int front, int isolated) {
+    struct cut_UnitQueue *queue = cut_ThreadTest(testId) ? &cut_schedule.threadQueue : &cut_schedule.queue;
+    int64_t priority = isolated ? INT64_MAX : cut_UnitPriority(testId, subtest);
+    // with known durations the longest units go first, everything else keeps its place
+    int ordered = front && !isolated && cut_arguments.history;
+    if (front && !ordered && queue->head) {
+        --queue->head;
+        queue->units[queue->head].testId = testId;
+        queue->units[queue->head].subtest = subtest;
+        queue->units[queue->head].isolated = isolated;
+        queue->units[queue->head].priority = priority;
+        return;
+    }
+    if (queue->size == queue->capacity) {
+        queue->capacity += 64;
+        queue->units = (struct cut_UnitId *)realloc(queue->units,
+            sizeof(struct cut_UnitId) * queue->capacity);
+        if (!queue->units)
+            cut_FatalExit("cannot allocate memory for unit queue");
+    }
+    struct cut_UnitId *position = queue->units + queue->size;
+    if (front) {
+        position = queue->units + queue->head;
+        while (ordered && position != queue->units + queue->size && position->priority >= priority)
+            ++position;
+        memmove(position + 1, position, sizeof(struct cut_UnitId) * (queue->units + queue->size - position));
+    }
+    position->testId = testId;
+    position->subtest = subtest;
+    position->isolated = isolated;
+    position->priority = priority;
+    ++queue->size;
+}
+
+CUT_PRIVATE void cut_EnqueueUnit(int testId, int subtest, int front, int isolated) {
+    if (cut_schedule.stopped)
+        return;
+    // an interrupted batch returns units which have been counted already
+    int copies = isolated ? 1 : cut_RepeatCopies(testId, subtest);
+    for (int i = 0; i < copies; ++i)
+        cut_PushUnit(testId, subtest, front, isolated);
+}
+
+CUT_PRIVATE int cut_PriorityComparator(const void *_lhs, const void *_rhs) {
+    const struct cut_UnitId *lhs = (const struct cut_UnitId *)_lhs;
+    const struct cut_UnitId *rhs = (const struct cut_UnitId *)_rhs;
+
+    if (lhs->priority != rhs->priority)
+        return lhs->priority < rhs->priority ? 1 : -1;
+    return lhs->testId - rhs->testId;
+}
+
+CUT_PRIVATE void cut_TakeUnit(struct cut_UnitQueue *queue, int position, struct cut_UnitId *unit) {
+    *unit = queue->units[position];
+    if (position == queue->head) {
+        ++queue->head;
+    } else {
+        memmove(queue->units + position, queue->units + position + 1,
+                sizeof(struct cut_UnitId) * (queue->size - position - 1));
+        --queue->size;
+    }
+    if (queue->head == queue->size)
+        queue->head = queue->size = 0;
+}
+
+CUT_PRIVATE int cut_SharedResource(int lhs, int rhs) {
+    const char **left = cut_unitTests.tests[lhs].resources;
+    const char **right = cut_unitTests.tests[rhs].resources;
+    for (; left && *left; ++left) {
+        for (const char **resource = right; resource && *resource; ++resource) {
+            if (!strcmp(*left, *resource))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+CUT_PRIVATE int cut_ResourceBusy(int testId) {
+    if (!cut_unitTests.tests[testId].resources)
+        return 0;
+    // a slot holds resources of its whole batch until it is done
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        const struct cut_Slot *slot = &cut_schedule.slots[i];
+        if (slot->state != cut_SLOT_RUNNING)
+            continue;
+        for (int k = 0; k < slot->batchSize; ++k) {
+            if (cut_SharedResource(testId, slot->batch[k].testId))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+CUT_PRIVATE int cut_MemoryFits(const struct cut_Slot *slot, int64_t memory) {
+    if (!cut_arguments.memoryBudget || slot->thread)
+        return 1;
+    int64_t reserved = 0;
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        const struct cut_Slot *other = &cut_schedule.slots[i];
+        if (other->state == cut_SLOT_RUNNING && !other->thread)
+            reserved += other->memory;
+    }
+    // a unit bigger than the whole budget runs alone rather than never
+    if (!reserved && !slot->batchSize)
+        return 1;
+    return reserved + memory <= cut_arguments.memoryBudget;
+}
+
+CUT_PRIVATE int cut_OverBudget(const struct cut_Slot *slot, int testId, int subtest) {
+    if (!cut_arguments.timeBudget)
+        return 0;
+    // units of a batch run one after another
+    int64_t finish = cut_Now() + cut_EstimateDuration(testId, subtest);
+    for (int i = 0; i < slot->batchSize; ++i)
+        finish += cut_EstimateDuration(slot->batch[i].testId, slot->batch[i].subtest);
+    return finish > cut_schedule.started + cut_arguments.timeBudget;
+}
+
+CUT_PRIVATE void cut_DeferUnit(const struct cut_UnitId *unit) {
+    struct cut_TestProgress *progress = &cut_schedule.tests[unit->testId];
+    cut_ReserveResults(progress, unit->subtest);
+    if (unit->subtest > progress->subtests)
+        progress->subtests = unit->subtest;
+    // copies of a repeated unit are deferred only once
+    if (progress->finished[unit->subtest])
+        return;
+    memset(&progress->results[unit->subtest], 0, sizeof(struct cut_UnitResult));
+    progress->results[unit->subtest].deferred = 1;
+    progress->finished[unit->subtest] = 1;
+    progress->deferred = 1;
+    ++cut_schedule.deferred;
+}
+
+CUT_PRIVATE struct cut_UnitQueue *cut_SlotQueue(const struct cut_Slot *slot) {
+    return slot->thread ? &cut_schedule.threadQueue : &cut_schedule.queue;
+}
+
+CUT_PRIVATE void cut_DequeueBatch(struct cut_Slot *slot) {
+    struct cut_UnitQueue *queue = cut_SlotQueue(slot);
+    // a unit run in the runner is always alone
+    int limit = cut_RunsInProcess() && !slot->thread ? 1 : cut_arguments.batch;
+    int slots = slot->thread ? cut_schedule.threadCount : cut_schedule.slotCount - cut_schedule.threadCount;
+    // leave some work for the other slots as well
+    int share = (queue->size - queue->head + slots - 1) / slots;
+    if (share < limit)
+        limit = share;
+    if (!slot->batch) {
+        slot->batch = (struct cut_UnitId *)malloc(sizeof(struct cut_UnitId) * cut_arguments.batch);
+        if (!slot->batch)
+            cut_FatalExit("cannot allocate memory for batch");
+    }
+    slot->batchSize = 0;
+    slot->batchDone = 0;
+    slot->memory = 0;
+    // units whose resources or memory are taken wait in the queue, the ones behind them go first
+    for (int position = queue->head; slot->batchSize < limit && position < queue->size;) {
+        int64_t memory = cut_EstimateMemory(queue->units[position].testId, queue->units[position].subtest);
+        // units of a batch run one after another, the process peaks with the biggest one
+        if (memory < slot->memory)
+            memory = slot->memory;
+        if (cut_ResourceBusy(queue->units[position].testId) || !cut_MemoryFits(slot, memory)) {
+            ++position;
+            continue;
+        }
+        // a unit which would not end within the budget is not started at all
+        if (cut_OverBudget(slot, queue->units[position].testId, queue->units[position].subtest)) {
+            struct cut_UnitId deferred;
+            cut_TakeUnit(queue, position, &deferred);
+            cut_DeferUnit(&deferred);
+            if (position < queue->head)
+                position = queue->head;
+            continue;
+        }
+        if (slot->batchSize && queue->units[position].isolated)
+            break;
+        cut_TakeUnit(queue, position, &slot->batch[slot->batchSize]);
+        slot->memory = memory;
+        if (position < queue->head)
+            position = queue->head;
+        if (slot->batch[slot->batchSize++].isolated)
+            break;
+    }
+    if (slot->batchSize)
+        slot->unit = slot->batch[0];
+}
+
+CUT_PRIVATE void cut_ReserveResults(struct cut_TestProgress *progress, int subtests) {
+    if (subtests < progress->capacity)
+        return;
+    int capacity = subtests + 1;
+    progress->results = (struct cut_UnitResult *)realloc(progress->results,
+        sizeof(struct cut_UnitResult) * capacity);
+    progress->stats = (struct cut_UnitStats *)realloc(progress->stats,
+        sizeof(struct cut_UnitStats) * capacity);
+    progress->finished = (char *)realloc(progress->finished, capacity);
+    if (!progress->results || !progress->stats || !progress->finished)
+        cut_FatalExit("cannot allocate memory for unit results");
+    memset(progress->results + progress->capacity, 0,
+           sizeof(struct cut_UnitResult) * (capacity - progress->capacity));
+    memset(progress->stats + progress->capacity, 0,
+           sizeof(struct cut_UnitStats) * (capacity - progress->capacity));
+    memset(progress->finished + progress->capacity, 0, capacity - progress->capacity);
+    progress->capacity = capacity;
+}
+
+CUT_PRIVATE void cut_DiscoverSubtests(int testId, int subtests) {
+    struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+    if (subtests <= progress->subtests)
+        return;
+    int known = progress->subtests;
+    cut_ReserveResults(progress, subtests);
+    progress->subtests = subtests;
+    // forked subtests report themselves from within the first run
+    if (cut_arguments.subtestId >= 0 || cut_arguments.rerunFailed
+        || (cut_arguments.forkSubtests && !cut_ThreadTest(testId)))
+    {
+        return;
+    }
+    if (cut_arguments.history) {
+        for (int subtest = known + 1; subtest <= subtests; ++subtest)
+            cut_EnqueueUnit(testId, subtest, 1, 0);
+        return;
+    }
+    // newly discovered subtests go first so the test can be printed soon
+    for (int subtest = subtests; subtest > known; --subtest)
+        cut_EnqueueUnit(testId, subtest, 1, 0);
+}
+
+CUT_PRIVATE void cut_ResetDeadline(struct cut_Slot *slot) {
+    // a thread cannot be killed, thread-safe units are not watched
+    int subtest = slot->branchId ? slot->branchId : slot->unit.subtest;
+    unsigned timeout = slot->thread ? 0 : cut_UnitTimeout(slot->unit.testId, subtest);
+    slot->deadline = timeout ? cut_Now() + (int64_t)timeout * 1000 : 0;
+}
+
+CUT_PRIVATE void cut_FinishBranch(struct cut_Slot *slot) {
+    slot->branch.duration = cut_Now() - slot->branchStarted;
+    cut_StoreResult(slot->unit.testId, slot->branchId, &slot->branch);
+    slot->branchId = 0;
+    slot->branchPid = 0;
+    slot->progress = -1;
+    cut_ResetDeadline(slot);
+}
+
+CUT_PRIVATE void cut_AdvanceBatch(struct cut_Slot *slot, int testId, int subtest) {
+    // the previous unit of the batch is done once the next one begins
+    if (slot->batchDone) {
+        slot->result.duration = cut_Now() - slot->unitStarted;
+        cut_LeavePrivateDir(slot, &slot->result);
+        cut_StoreResult(slot->unit.testId, slot->unit.subtest, &slot->result);
+    }
+    if (slot->batchDone == slot->batchSize
+        || slot->batch[slot->batchDone].testId != testId
+        || slot->batch[slot->batchDone].subtest != subtest)
+    {
+        cut_FatalExit("unexpected unit in batch");
+    }
+    slot->unit = slot->batch[slot->batchDone++];
+    slot->unitStarted = cut_Now();
+    slot->terminated = 0;
+    slot->progress = -1;
+    cut_ResetDeadline(slot);
+}
+
+CUT_PRIVATE void cut_SlotMessage(struct cut_Slot *slot, struct cut_Fragment *message) {
+    switch (message->id) {
+    case cut_MESSAGE_UNIT:
+        message->sliceCount == 2 || cut_FatalExit("invalid unit:message format");
+        cut_AdvanceBatch(slot,
+                         *(int *)cut_FragmentGet(message, 0, NULL),
+                         *(int *)cut_FragmentGet(message, 1, NULL));
+        return;
+    case cut_MESSAGE_BRANCH:
+        message->sliceCount == 2 || cut_FatalExit("invalid branch:message format");
+        memset(&slot->branch, 0, sizeof(slot->branch));
+        slot->branchId = *(int *)cut_FragmentGet(message, 0, NULL);
+        slot->branchPid = *(int *)cut_FragmentGet(message, 1, NULL);
+        slot->branchTerminated = 0;
+        slot->branchStarted = cut_Now();
+        slot->progress = -1;
+        cut_ResetDeadline(slot);
+        return;
+    case cut_MESSAGE_HEARTBEAT:
+        message->sliceCount == 1 || cut_FatalExit("invalid heartbeat:message format");
+        // the timeout of a beating unit counts from its last beat
+        slot->progress = *(int *)cut_FragmentGet(message, 0, NULL);
+        if (slot->deadline)
+            cut_ResetDeadline(slot);
+        return;
+    case cut_MESSAGE_STATUS:
+        message->sliceCount == 2 || cut_FatalExit("invalid status:message format");
+        // a thread reports its end this way, its pipe may be held open by forked units
+        if (slot->thread && !slot->branchId) {
+            slot->eof = 1;
+            slot->exited = 1;
+            return;
+        }
+        if (!slot->branchId)
+            return;
+        slot->branch.returnCode = *(int *)cut_FragmentGet(message, 0, NULL);
+        slot->branch.signal = *(int *)cut_FragmentGet(message, 1, NULL);
+        slot->branch.failed |= slot->branch.returnCode || slot->branch.signal;
+        cut_FinishBranch(slot);
+        return;
+    }
+    if (slot->branchId) {
+        if (!slot->branchTerminated && !cut_ProcessMessage(message, &slot->branch))
+            slot->branchTerminated = 1;
+        return;
+    }
+    if (slot->terminated)
+        return;
+    if (!cut_ProcessMessage(message, &slot->result))
+        slot->terminated = 1;
+    if (message->id == cut_MESSAGE_OK)
+        cut_DiscoverSubtests(slot->unit.testId, slot->result.subtests);
+}
+
+CUT_PRIVATE void cut_SlotFeed(struct cut_Slot *slot, const char *data, size_t length) {
+    if (slot->length + length > slot->capacity) {
+        slot->capacity = slot->length + length + 4096;
+        slot->buffer = (char *)realloc(slot->buffer, slot->capacity);
+        if (!slot->buffer)
+            cut_FatalExit("cannot allocate memory for reading a message");
+    }
+    memcpy(slot->buffer + slot->length, data, length);
+    slot->length += length;
+
+    size_t offset = 0;
+    while (slot->length - offset >= sizeof(struct cut_FragmentHeader)) {
+        struct cut_FragmentHeader header;
+        memcpy(&header, slot->buffer + offset, sizeof(header));
+        if (header.length < sizeof(header))
+            cut_FatalExit("invalid message header");
+        if (slot->length - offset < header.length)
+            break;
+
+        struct cut_Fragment message;
+        cut_FragmentInit(&message, cut_NO_TYPE);
+        message.serialized = (char *)malloc(header.length);
+        if (!message.serialized)
+            cut_FatalExit("cannot allocate memory for reading a message");
+        memcpy(message.serialized, slot->buffer + offset, header.length);
+        cut_FragmentDeserialize(&message) || cut_FatalExit("cannot deserialize message");
+        cut_SlotMessage(slot, &message);
+        cut_FragmentClean(&message);
+        offset += header.length;
+    }
+    memmove(slot->buffer, slot->buffer + offset, slot->length - offset);
+    slot->length -= offset;
+}
+
+CUT_PRIVATE unsigned cut_UnitTimeout(int testId, int subtest) {
+    if (cut_unitTests.tests[testId].timeout)
+        return cut_unitTests.tests[testId].timeout;
+    unsigned adaptive = cut_AdaptiveTimeout(testId, subtest);
+    return adaptive ? adaptive : cut_arguments.timeout;
+}
+
+CUT_PRIVATE int cut_WaitTimeout() {
+    int64_t now = cut_Now();
+    int64_t nearest = -1;
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        const struct cut_Slot *slot = &cut_schedule.slots[i];
+        if (slot->state != cut_SLOT_RUNNING || !slot->deadline)
+            continue;
+        int64_t remaining = slot->deadline > now ? (slot->deadline - now + 999) / 1000 : 0;
+        if (nearest < 0 || remaining < nearest)
+            nearest = remaining;
+    }
+    // the load is sampled even when no unit is about to end
+    int scaling = cut_ScalingTimeout();
+    if (scaling >= 0 && (nearest < 0 || scaling < nearest))
+        nearest = scaling;
+    return (int)nearest;
+}
+
+CUT_PRIVATE void cut_CheckDeadlines() {
+    int64_t now = cut_Now();
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        struct cut_Slot *slot = &cut_schedule.slots[i];
+        if (slot->state != cut_SLOT_RUNNING || !slot->deadline || slot->deadline > now)
+            continue;
+        if (slot->branchPid) {
+            // only the forked subtest is stopped, the first run goes on with the next one
+            cut_KillUnit(slot->branchPid);
+            slot->branch.timeouted = 1;
+            slot->branch.failed = 1;
+            slot->deadline = 0;
+            continue;
+        }
+        cut_KillUnit(slot->pid);
+        slot->result.timeouted = 1;
+        slot->result.failed = 1;
+        slot->deadline = 0;
+    }
+}
+
+CUT_PRIVATE int cut_RunsInProcess() {
+    return cut_arguments.noFork || (cut_arguments.autoIsolate && !cut_schedule.tainted);
+}
+
+CUT_PRIVATE void cut_IsolateUnit(struct cut_Slot *slot) {
+    // the runner cannot be trusted anymore, the rest of units goes to fresh processes
+    cut_schedule.tainted = 1;
+    cut_arguments.spawn = 1;
+    ++cut_schedule.isolated;
+    cut_CleanMemory(&slot->result);
+    memset(&slot->result, 0, sizeof(slot->result));
+    cut_EnqueueUnit(slot->unit.testId, slot->unit.subtest, 1, 1);
+}
+
+CUT_PRIVATE void cut_StartUnit(struct cut_Slot *slot) {
+    memset(&slot->result, 0, sizeof(slot->result));
+    slot->terminated = 0;
+    slot->anomaly = 0;
+    slot->pid = 0;
+    slot->pipeRead = -1;
+    slot->pidFd = -1;
+    slot->eof = 0;
+    slot->exited = 0;
+    slot->deadline = 0;
+    slot->branchId = 0;
+    slot->branchPid = 0;
+    slot->progress = -1;
+    slot->length = 0;
+    slot->state = cut_SLOT_RUNNING;
+    ++cut_schedule.running;
+
+    slot->started = cut_Now();
+    slot->unitStarted = slot->started;
+    if (slot->thread) {
+        cut_LaunchThread(slot);
+        ++cut_schedule.inProcess;
+    } else if (cut_RunsInProcess()) {
+        uint64_t fingerprint = cut_arguments.autoIsolate ? cut_ProcessFingerprint() : 0;
+        cut_RunUnitForkless(slot->unit.testId, slot->unit.subtest, &slot->result);
+        slot->state = cut_SLOT_DONE;
+        ++cut_schedule.inProcess;
+        slot->anomaly = cut_arguments.autoIsolate
+            && (slot->result.signal || slot->result.timeouted || fingerprint != cut_ProcessFingerprint());
+    } else {
+        cut_LaunchUnit(slot);
+        cut_schedule.launchTime += cut_Now() - slot->started;
+    }
+    ++cut_schedule.launched;
+    if (slot->state == cut_SLOT_RUNNING)
+        cut_ResetDeadline(slot);
+    else
+        slot->batchDone = slot->batchSize;
+}
+
+CUT_PRIVATE void cut_StoreResult(int testId, int subtest, struct cut_UnitResult *result) {
+    struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+
+    // units killed by a stopped run are reported as cancelled, whatever they did
+    if (cut_schedule.stopped) {
+        cut_CleanMemory(result);
+        memset(result, 0, sizeof(*result));
+        return;
+    }
+
+    if (result->timeouted)
+        result->timeout = cut_UnitTimeout(testId, subtest);
+    cut_DiscoverSubtests(testId, result->subtests);
+    cut_ReserveResults(progress, subtest);
+    if (subtest > progress->subtests)
+        progress->subtests = subtest;
+    ++cut_schedule.units;
+    cut_RecordDuration(testId, subtest, result->duration);
+    cut_RecordMemory(testId, subtest, result->memory);
+    cut_RecordFailure(testId, subtest, result->failed);
+    cut_RecordSample(testId, subtest, result);
+    if (cut_RepeatUnit(testId, subtest, result))
+        return;
+    progress->results[subtest] = *result;
+    progress->finished[subtest] = 1;
+    cut_RecordCache(testId, subtest, result);
+    cut_RecordOutcome(testId, subtest, result);
+    cut_RecordJournal(testId, subtest, result);
+    if (result->failed)
+        ++progress->failed;
+    memset(result, 0, sizeof(*result));
+    if (progress->results[subtest].failed && cut_arguments.failFast
+        && ++cut_schedule.failedUnits >= cut_arguments.failFast)
+    {
+        cut_StopSchedule();
+    }
+}
+
+CUT_PRIVATE void cut_StopSchedule() {
+    cut_schedule.stopped = 1;
+    cut_FlushRepeats();
+    cut_schedule.queue.head = 0;
+    cut_schedule.queue.size = 0;
+    cut_schedule.threadQueue.head = 0;
+    cut_schedule.threadQueue.size = 0;
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        struct cut_Slot *slot = &cut_schedule.slots[i];
+        if (slot->state != cut_SLOT_RUNNING || !slot->pid)
+            continue;
+        if (slot->branchPid)
+            cut_KillUnit(slot->branchPid);
+        cut_KillUnit(slot->pid);
+        slot->deadline = 0;
+    }
+}
+
+CUT_PRIVATE void cut_FinishUnit(struct cut_Slot *slot) {
+    int64_t now = cut_Now();
+    cut_schedule.unitTime += now - slot->started;
+    slot->result.duration = now - slot->unitStarted;
+    if (!slot->batchDone)
+        slot->batchDone = 1;
+    cut_ReadEmergencyLog(slot->pid, &slot->result);
+    if (slot->branchId) {
+        // the first run died while a forked subtest was running
+        slot->branch.returnCode = slot->result.returnCode;
+        slot->branch.signal = slot->result.signal;
+        slot->branch.failed = 1;
+        cut_FinishBranch(slot);
+    }
+    cut_LeavePrivateDir(slot, &slot->result);
+    // the verdict is given by the run in a process of its own
+    if (slot->anomaly)
+        cut_IsolateUnit(slot);
+    else
+        cut_StoreResult(slot->unit.testId, slot->unit.subtest, &slot->result);
+    // the batch was interrupted, the rest is run one unit per process
+    for (int i = slot->batchSize - 1; i >= slot->batchDone; --i)
+        cut_EnqueueUnit(slot->batch[i].testId, slot->batch[i].subtest, 1, 1);
+    slot->state = cut_SLOT_FREE;
+    --cut_schedule.running;
+}
+
+CUT_PRIVATE uint64_t cut_HashBytes(uint64_t hash, const void *data, size_t length) {
+    // FNV-1a, the same on every platform and build
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+CUT_PRIVATE uint64_t cut_HashMix(uint64_t hash) {
+    // final mixing, similar inputs have to give unrelated hashes
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+CUT_PRIVATE uint64_t cut_Hash(const char *text, uint64_t seed) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i, seed >>= 8)
+        bytes[i] = seed & 0xff;
+    uint64_t hash = cut_HashBytes(14695981039346656037ULL, bytes, sizeof(bytes));
+    return cut_HashMix(cut_HashBytes(hash, text, strlen(text)));
+}
+
+CUT_PRIVATE int cut_HashComparator(const void *_lhs, const void *_rhs) {
+    uint64_t lhs = cut_Hash(cut_unitTests.tests[*(const int *)_lhs].name, 0);
+    uint64_t rhs = cut_Hash(cut_unitTests.tests[*(const int *)_rhs].name, 0);
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/* Every test prefers shards in the order given by hashes of its name (rendezvous hashing),
+   so a new test never moves the others by itself. With a history, a shard takes tests only
+   up to a bit more than its fair share of the expected time and the rest falls through to
+   the next preferred shards.
+ */
+CUT_PRIVATE void cut_SelectShard() {
+    if (!cut_arguments.shardCount)
+        return;
+    int count = 0;
+    int64_t total = 0;
+    int *tests = (int *)malloc(sizeof(int) * (cut_unitTests.size + 1));
+    int64_t *loads = (int64_t *)calloc(cut_arguments.shardCount, sizeof(int64_t));
+    if (!tests || !loads)
+        cut_FatalExit("cannot allocate memory for shards");
+    for (int i = 0; i < cut_unitTests.size; ++i) {
+        if (!cut_schedule.tests[i].selected)
+            continue;
+        tests[count++] = i;
+        total += cut_UnitPriority(i, 0);
+    }
+    qsort(tests, count, sizeof(int), cut_HashComparator);
+    int64_t capacity = total + total / 10;
+    capacity = capacity / cut_arguments.shardCount + 1;
+
+    for (int i = 0; i < count; ++i) {
+        struct cut_TestProgress *progress = &cut_schedule.tests[tests[i]];
+        const char *name = cut_unitTests.tests[tests[i]].name;
+        int64_t weight = cut_UnitPriority(tests[i], 0);
+        int chosen = -1;
+        uint64_t best = 0;
+        int lightest = 0;
+        for (int shard = 0; shard < cut_arguments.shardCount; ++shard) {
+            uint64_t score = cut_Hash(name, shard + 1);
+            if (loads[shard] < loads[lightest])
+                lightest = shard;
+            if (total && loads[shard] + weight > capacity)
+                continue;
+            if (chosen < 0 || score > best) {
+                chosen = shard;
+                best = score;
+            }
+        }
+        if (chosen < 0)
+            chosen = lightest;
+        loads[chosen] += weight;
+        if (chosen + 1 != cut_arguments.shardIndex)
+            progress->selected = 0;
+    }
+    cut_schedule.estimated = loads[cut_arguments.shardIndex - 1];
+    free(tests);
+    free(loads);
+}
+
+CUT_PRIVATE int cut_StartedTest(const struct cut_TestProgress *progress) {
+    for (int subtest = 0; subtest <= progress->subtests; ++subtest) {
+        if (progress->finished[subtest])
+            return 1;
+    }
+    return 0;
+}
+
+CUT_PRIVATE void cut_ClearStatus() {
+    if (!cut_schedule.statusLength)
+        return;
+    fprintf(cut_output, "\033[%dD\033[K", cut_schedule.statusLength);
+    fflush(cut_output);
+    cut_schedule.statusLength = 0;
+}
+
+// progress of beating units follows the line of the test which is printed next, until it is taken back
+CUT_PRIVATE void cut_PrintStatus() {
+    if (cut_arguments.noColor || cut_schedule.printHead >= cut_unitTests.size)
+        return;
+    int64_t now = cut_Now();
+    if (cut_schedule.statusLength && now - cut_schedule.statusShown < CUT_STATUS_PERIOD)
+        return;
+    const struct cut_TestProgress *head = &cut_schedule.tests[cut_schedule.printHead];
+    int room = 79 - (head->base >= 0 && !head->printed ? head->base : 0);
+    char status[128];
+    int length = 0;
+    for (int i = 0; i < cut_schedule.slotCount && length < (int)sizeof(status); ++i) {
+        const struct cut_Slot *slot = &cut_schedule.slots[i];
+        if (slot->state != cut_SLOT_RUNNING || slot->progress < 0)
+            continue;
+        const char *name = cut_unitTests.tests[slot->unit.testId].name;
+        int subtest = slot->branchId ? slot->branchId : slot->unit.subtest;
+        const char *separator = length ? ", " : "  [";
+        if (subtest)
+            length += snprintf(status + length, sizeof(status) - length, "%s%s/%i: %i",
+                               separator, name, subtest, slot->progress);
+        else
+            length += snprintf(status + length, sizeof(status) - length, "%s%s: %i",
+                               separator, name, slot->progress);
+    }
+    cut_ClearStatus();
+    if (!length || room < 8)
+        return;
+    if (length > room - 1)
+        length = room - 1;
+    status[length++] = ']';
+    cut_schedule.statusLength = fprintf(cut_output, "%.*s", length, status);
+    cut_schedule.statusShown = now;
+    fflush(cut_output);
+}
+
+CUT_PRIVATE void cut_PrintProgress() {
+    // once a stopped run settles down, the unfinished units are reported as cancelled
+    int draining = cut_schedule.stopped && !cut_schedule.running;
+    while (cut_schedule.printHead < cut_unitTests.size) {
+        int testId = cut_schedule.printHead;
+        struct cut_TestProgress *progress = &cut_schedule.tests[testId];
+        if (!progress->selected) {
+            ++cut_schedule.printHead;
+            continue;
+        }
+        if (draining && progress->base < 0 && !cut_StartedTest(progress)) {
+            --cut_schedule.executed;
+            ++cut_schedule.printHead;
+            continue;
+        }
+        if (progress->base < 0) {
+            cut_ClearStatus();
+            progress->base = fprintf(cut_output, "[%3i] %s", progress->number,
+                                     cut_unitTests.tests[testId].name);
+            fflush(cut_output);
+        }
+        for (; progress->printed <= progress->subtests; ++progress->printed) {
+            int subtest = progress->printed;
+            if (cut_arguments.subtestId >= 0 && cut_arguments.subtestId != subtest)
+                continue;
+            if (cut_arguments.rerunFailed && !cut_RerunUnit(testId, subtest)) {
+                // the line of the test is finished by its first run otherwise
+                if (!subtest) {
+                    cut_ClearStatus();
+                    putc('\n', cut_output);
+                }
+                continue;
+            }
+            if (!progress->finished[subtest]) {
+                if (!draining)
+                    return;
+                progress->results[subtest].cancelled = 1;
+                progress->cancelled = 1;
+            }
+            cut_ClearStatus();
+            cut_PrintResult(progress->base, subtest, progress->subtests, &progress->results[subtest]);
+            cut_CleanMemory(&progress->results[subtest]);
+        }
+        if (progress->subtests > 1) {
+            int base = fprintf(cut_output, "[%3i] %s (overall)", progress->number,
+                               cut_unitTests.tests[testId].name);
+            struct cut_UnitResult result;
+            memset(&result, 0, sizeof(result));
+            result.failed = progress->failed;
+            result.cached = progress->cached;
+            result.cancelled = progress->cancelled;
+            result.deferred = progress->deferred;
+            cut_PrintResult(base, 0, -1, &result);
+        }
+        if (progress->failed)
+            ++cut_schedule.failed;
+        else if (progress->cancelled)
+            --cut_schedule.executed;
+        else if (progress->deferred)
+            ++cut_schedule.deferredTests;
+        ++cut_schedule.printHead;
+    }
+}
+
+CUT_PRIVATE void cut_FillSlots() {
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        struct cut_Slot *slot = &cut_schedule.slots[i];
+        if (slot->state != cut_SLOT_FREE)
+            continue;
+        if (cut_SlotQueue(slot)->head == cut_SlotQueue(slot)->size || !cut_JobsAvailable(slot))
+            continue;
+        cut_DequeueBatch(slot);
+        if (!slot->batchSize)
+            continue;
+        cut_StartUnit(slot);
+        if (slot->state == cut_SLOT_DONE) {
+            // synchronous launch, the slot can be reused right away
+            cut_FinishUnit(slot);
+            cut_PrintProgress();
+            --i;
+        }
+    }
+}
+
+CUT_PRIVATE void cut_CollectSlots() {
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        if (cut_schedule.slots[i].state == cut_SLOT_DONE)
+            cut_FinishUnit(&cut_schedule.slots[i]);
+    }
+}
+
+CUT_PRIVATE void cut_RunSchedule() {
+    cut_schedule.threadCount = cut_arguments.threads > 0 ? cut_arguments.threads : 0;
+    cut_schedule.slotCount = (cut_arguments.jobs > 0 ? cut_arguments.jobs : 1) + cut_schedule.threadCount;
+    cut_schedule.slots = (struct cut_Slot *)calloc(cut_schedule.slotCount, sizeof(struct cut_Slot));
+    cut_schedule.tests = (struct cut_TestProgress *)calloc(cut_unitTests.size, sizeof(struct cut_TestProgress));
+    if (!cut_schedule.slots || (cut_unitTests.size && !cut_schedule.tests))
+        cut_FatalExit("cannot allocate memory for scheduler");
+    cut_schedule.started = cut_Now();
+    for (int i = 0; i < cut_schedule.threadCount; ++i)
+        cut_schedule.slots[cut_schedule.slotCount - 1 - i].thread = 1;
+
+    for (int i = 0; i < cut_unitTests.size; ++i) {
+        cut_schedule.tests[i].base = -1;
+        cut_schedule.tests[i].selected = !cut_SkipUnit(i)
+            && (!cut_arguments.rerunFailed || cut_RerunTest(i));
+    }
+    cut_SelectShard();
+
+    for (int i = 0; i < cut_unitTests.size; ++i) {
+        struct cut_TestProgress *progress = &cut_schedule.tests[i];
+        if (!progress->selected)
+            continue;
+        progress->number = ++cut_schedule.executed;
+        if (cut_arguments.subtestId > 0)
+            progress->subtests = cut_arguments.subtestId;
+        if (cut_CachedTest(i) || cut_ResumedTest(i))
+            continue;
+        if (cut_arguments.rerunFailed) {
+            cut_EnqueueRerun(i);
+            continue;
+        }
+        cut_ReserveResults(progress, progress->subtests);
+        cut_EnqueueUnit(i, cut_arguments.subtestId > 0 ? cut_arguments.subtestId : 0, 0, 0);
+    }
+    if (cut_arguments.history) {
+        qsort(cut_schedule.queue.units, cut_schedule.queue.size, sizeof(struct cut_UnitId), cut_PriorityComparator);
+        qsort(cut_schedule.threadQueue.units, cut_schedule.threadQueue.size, sizeof(struct cut_UnitId),
+              cut_PriorityComparator);
+    }
+    if (cut_arguments.watch) {
+        cut_FailedFirst(&cut_schedule.queue);
+        cut_FailedFirst(&cut_schedule.threadQueue);
+    }
+
+    cut_StartScaling();
+    for (;;) {
+        cut_PrintProgress();
+        cut_AdaptJobs();
+        cut_FillSlots();
+        if (!cut_schedule.running)
+            break;
+        cut_WaitForUnits(cut_schedule.slots, cut_schedule.slotCount, cut_WaitTimeout());
+        cut_CheckDeadlines();
+        cut_CollectSlots();
+        cut_PrintStatus();
+    }
+    cut_ClearStatus();
+    cut_PrintProgress();
+}
+
+CUT_PRIVATE void cut_PrintStatistics() {
+    const char *launcher = cut_arguments.noFork ? "no fork"
+                         : cut_arguments.autoIsolate ? "auto isolate"
+                         : cut_arguments.spawn ? "spawn" : "fork";
+    int units = cut_schedule.units ? cut_schedule.units : 1;
+    fprintf(cut_output,
+            "\nStatistics:\n"
+            "  launcher:  %s\n"
+            "  units:     %3i\n"
+            "  processes: %3i\n"
+            "  launch:    %.3f ms/unit\n"
+            "  runtime:   %.3f ms/unit\n"
+            "  wall time: %.3f s\n",
+            launcher,
+            cut_schedule.units,
+            cut_schedule.launched - cut_schedule.inProcess,
+            cut_schedule.launchTime / 1000.0 / units,
+            cut_schedule.unitTime / 1000.0 / units,
+            (cut_Now() - cut_schedule.started) / 1000000.0);
+    if (cut_arguments.autoIsolate)
+        fprintf(cut_output, "  isolated:  %3i\n", cut_schedule.isolated);
+}
+
+CUT_PRIVATE void cut_CleanSchedule() {
+    for (int i = 0; i < cut_schedule.slotCount; ++i) {
+        free(cut_schedule.slots[i].buffer);
+        free(cut_schedule.slots[i].batch);
+    }
+    for (int i = 0; cut_schedule.tests && i < cut_unitTests.size; ++i) {
+        for (int subtest = 0; subtest < cut_schedule.tests[i].capacity; ++subtest)
+            cut_CleanStats(&cut_schedule.tests[i].stats[subtest]);
+        free(cut_schedule.tests[i].stats);
+        free(cut_schedule.tests[i].results);
+        free(cut_schedule.tests[i].finished);
+    }
+    free(cut_schedule.slots);
+    free(cut_schedule.tests);
+    free(cut_schedule.queue.units);
+    free(cut_schedule.threadQueue.units);
+    cut_schedule.slots = NULL;
+    cut_schedule.tests = NULL;
+    cut_schedule.queue.units = NULL;
+    cut_schedule.threadQueue.units = NULL;
+    cut_schedule.slotCount = 0;
+}
+
+#endif // CUT_SCHEDULER_H
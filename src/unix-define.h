@@ -5,10 +5,16 @@
 # define CUT_NORETURN __attribute__((noreturn))
 # define CUT_CONSTRUCTOR(name) __attribute__((constructor)) static void name()
 # define CUT_UNUSED(name) __attribute__((unused)) name
+# define CUT_THREAD_LOCAL __thread
 #else
 # error "unsupported compiler"
 #endif
 
+// a unit jumps out of the signal handler on its crash, the jump has to restore its signal mask
+# define CUT_JUMP_BUFFER sigjmp_buf
+# define CUT_SET_JUMP(point) sigsetjmp(point, 1)
+# define CUT_LONG_JUMP(point) siglongjmp(point, 1)
+
 #if defined(__clang__)
 # pragma clang system_header
 #elif defined(__GNUC__)
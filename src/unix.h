@@ -8,8 +8,29 @@
 # include <sys/wait.h>
 # include <fcntl.h>
 # include <signal.h>
+# include <time.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+# include <poll.h>
 # include <errno.h>
 # include <assert.h>
+# include <pthread.h>
+# include <ftw.h>
+
+enum { cut_GUARDED_SIGNALS = 4 };
+CUT_PRIVATE const int cut_guardedSignals[cut_GUARDED_SIGNALS] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+CUT_PRIVATE struct sigaction cut_guardedActions[cut_GUARDED_SIGNALS];
+CUT_PRIVATE char *cut_alternateStack = NULL;
+CUT_PRIVATE uint64_t cut_watchedStamp = 0;
+// the alarm and timers of the process belong to the tests, a unit run by the runner is timed by a watchdog thread
+# define CUT_TIMEOUT_SIGNAL SIGUSR2
+CUT_PRIVATE pthread_mutex_t cut_watchdogLock = PTHREAD_MUTEX_INITIALIZER;
+CUT_PRIVATE pthread_cond_t cut_watchdogWake = PTHREAD_COND_INITIALIZER;
+CUT_PRIVATE pthread_t cut_watchdogTarget;
+CUT_PRIVATE int cut_watchdogStarted = 0;
+CUT_PRIVATE unsigned cut_guardTimeout = 0;
+CUT_PRIVATE int64_t cut_guardDeadline = 0;
+CUT_PRIVATE volatile sig_atomic_t cut_guardActive = 0;
 
 CUT_PRIVATE int cut_IsTerminalOutput() {
     return isatty(fileno(stdout));
@@ -27,15 +48,113 @@ CUT_PRIVATE void cut_RedirectIO() {
 }
 
 CUT_PRIVATE void cut_ResumeIO() {
+    // buffered output of the unit must not outlive it, a batch runs more of them
+    fflush(stdout);
+    fflush(stderr);
     fclose(cut_stdout) != -1 || cut_FatalExit("cannot close file");
     fclose(cut_stderr) != -1 || cut_FatalExit("cannot close file");
     close(1) != -1 || cut_FatalExit("cannot close file");
     close(2) != -1 || cut_FatalExit("cannot close file");
     dup2(cut_originalStdOut, 1);
     dup2(cut_originalStdErr, 2);
+    close(cut_originalStdOut);
+    close(cut_originalStdErr);
     cut_outputsRedirected = 0;
 }
 
+struct cut_ThreadStart {
+    int pipeWrite;
+    int count;
+    struct cut_UnitId *units;
+};
+
+CUT_PRIVATE void *cut_ThreadMain(void *data) {
+    struct cut_ThreadStart *start = (struct cut_ThreadStart *)data;
+    cut_unitThread = 1;
+    cut_pipeWrite = start->pipeWrite;
+    cut_RunBatch(start->units, start->count);
+    cut_SendStatus(0, 0);
+    close(cut_pipeWrite);
+    free(start->units);
+    free(start);
+    return NULL;
+}
+
+CUT_PRIVATE void cut_LaunchThread(struct cut_Slot *slot) {
+    int pipefd[2];
+    pipe(pipefd) != -1 || cut_FatalExit("cannot establish communication pipe");
+    // spawned units must not keep the pipe, forked ones do not matter as the end is reported
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC) != -1 || cut_FatalExit("cannot set close-on-exec");
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC) != -1 || cut_FatalExit("cannot set close-on-exec");
+    fcntl(pipefd[0], F_SETFL, O_NONBLOCK) != -1 || cut_FatalExit("cannot set non-blocking pipe");
+
+    struct cut_ThreadStart *start = (struct cut_ThreadStart *)malloc(sizeof(struct cut_ThreadStart));
+    if (!start)
+        cut_FatalExit("cannot allocate memory for thread");
+    start->units = (struct cut_UnitId *)malloc(sizeof(struct cut_UnitId) * slot->batchSize);
+    if (!start->units)
+        cut_FatalExit("cannot allocate memory for thread");
+    memcpy(start->units, slot->batch, sizeof(struct cut_UnitId) * slot->batchSize);
+    start->count = slot->batchSize;
+    start->pipeWrite = pipefd[1];
+
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attributes, cut_ThreadMain, start) == 0 || cut_FatalExit("cannot start thread");
+    pthread_attr_destroy(&attributes);
+
+    slot->pipeRead = pipefd[0];
+}
+
+CUT_PRIVATE char *cut_MakePrivateRoot() {
+    const char *base = getenv("CUT_TMPDIR");
+    // scratch files of units do not need to outlive the run, memory is the fastest place for them
+    if (!base && access("/dev/shm", W_OK) == 0)
+        base = "/dev/shm";
+    if (!base)
+        base = getenv("TMPDIR");
+    if (!base)
+        base = "/tmp";
+    char *root = (char *)malloc(strlen(base) + 12);
+    if (!root)
+        cut_FatalExit("cannot allocate memory for private directory");
+    sprintf(root, "%s/cut-XXXXXX", base);
+    if (!mkdtemp(root))
+        cut_ErrorExit("cannot create private directory in %s", base);
+    return root;
+}
+
+CUT_PRIVATE void cut_EnterPrivateDir(int testId, int subtest, int index) {
+    if (!cut_arguments.privateRoot || cut_unitThread)
+        return;
+    // the runner looks for the log in its own directory
+    static char emergencyLog[4096];
+    if (*cut_emergencyLog != '/') {
+        char directory[4096];
+        getcwd(directory, sizeof(directory)) || cut_FatalExit("cannot get working directory");
+        snprintf(emergencyLog, sizeof(emergencyLog), "%s/%s", directory, cut_emergencyLog);
+        cut_emergencyLog = emergencyLog;
+    }
+    char path[4096];
+    cut_PrivateDir(path, sizeof(path), testId, subtest, getpid(), index);
+    mkdir(path, 0700) != -1 || cut_FatalExit("cannot create private directory");
+    chdir(path) != -1 || cut_FatalExit("cannot enter private directory");
+    setenv("CUT_TEST_DIR", path, 1) != -1 || cut_FatalExit("cannot set CUT_TEST_DIR");
+}
+
+CUT_PRIVATE int cut_RemoveEntry(const char *path, CUT_UNUSED(const struct stat *status),
+                                CUT_UNUSED(int type), CUT_UNUSED(struct FTW *position))
+{
+    remove(path);
+    return 0;
+}
+
+CUT_PRIVATE void cut_RemoveTree(const char *path) {
+    nftw(path, cut_RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
 CUT_PRIVATE int64_t cut_Read(int fd, char *destination, size_t bytes) {
     return read(fd, destination, bytes);
 }
@@ -44,59 +163,387 @@ CUT_PRIVATE int64_t cut_Write(int fd, const char *source, size_t bytes) {
     return write(fd, source, bytes);
 }
 
+CUT_PRIVATE uint64_t cut_ChangeStamp(uint64_t hash, const char *path) {
+    struct stat info;
+    if (stat(path, &info))
+        return cut_HashMix(hash);
+    hash = cut_HashBytes(hash, &info.st_ino, sizeof(info.st_ino));
+    hash = cut_HashBytes(hash, &info.st_size, sizeof(info.st_size));
+    return cut_HashBytes(hash, &info.st_mtime, sizeof(info.st_mtime));
+}
+
+CUT_PRIVATE uint64_t cut_WatchedStamp() {
+    uint64_t hash = cut_ChangeStamp(0, cut_arguments.selfName);
+    for (int i = 0; i < cut_arguments.watchDirCount; ++i)
+        hash = cut_ChangeStamp(hash, cut_arguments.watchDirs[i]);
+    return hash;
+}
+
 CUT_PRIVATE int cut_PreRun() {
-    return 0;
+    // there is no portable way to locate the own executable, units can only be forked here
+    if (cut_arguments.spawn)
+        cut_ErrorExit("option --spawn is not available on this system");
+    // namespaces are specific to linux
+    cut_arguments.sandbox = 0;
+    if (cut_arguments.pipe < 0) {
+        if (cut_arguments.watch)
+            cut_watchedStamp = cut_WatchedStamp();
+        return 0;
+    }
+
+    cut_pipeWrite = cut_arguments.pipe;
+    cut_emergencyLog = cut_EmergencyLog(getpid());
+    if (cut_globalSetupOnce)
+        cut_globalSetupOnce();
+
+    if (cut_arguments.unitCount) {
+        cut_RunBatch(cut_arguments.units, cut_arguments.unitCount);
+    } else {
+        struct cut_UnitId unit = {cut_arguments.testId, cut_arguments.subtestId, 0};
+        cut_RunBatch(&unit, 1);
+    }
+
+    close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
+    return 1;
 }
 
-CUT_PRIVATE void cut_SigAlrm(CUT_UNUSED(int signum)) {
-    cut_Timeouted();
-    _exit(cut_NORMAL_EXIT);
+CUT_PRIVATE int cut_ProcessorCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+CUT_PRIVATE int cut_ReadPressure(struct cut_Pressure *pressure) {
+    // there is no pressure stall information outside of linux, the load average has to do
+    double load;
+    pressure->cpu = -1;
+    pressure->memory = -1;
+    pressure->io = -1;
+    pressure->load = getloadavg(&load, 1) == 1 ? load / cut_ProcessorCount() : -1;
+    return pressure->load >= 0;
+}
+
+CUT_PRIVATE int64_t cut_Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
 }
 
-CUT_PRIVATE void cut_RunUnit(int testId, int subtest, struct cut_UnitResult *result) {
+// units are forked from the runner, so the runner itself serves as the zygote
+CUT_PRIVATE void cut_StartZygote() {
+    if (cut_globalSetupOnce)
+        cut_globalSetupOnce();
+}
+
+CUT_PRIVATE void cut_StopZygote() {
+}
+
+CUT_PRIVATE void cut_LaunchUnit(struct cut_Slot *slot) {
     int r;
     int pipefd[2];
     r = pipe(pipefd);
     if (r == -1)
         cut_FatalExit("cannot establish communication pipe");
 
-    cut_pipeRead = pipefd[0];
-    cut_pipeWrite = pipefd[1];
-
-    int pid = getpid();
-    int parentPid = getpid();
-    pid = fork();
+    fflush(cut_output);
+    int pid = fork();
     if (pid == -1)
         cut_FatalExit("cannot fork");
     if (!pid) {
         /// TODO: missing feature - kill child when parent dies
-        close(cut_pipeRead) != -1 || cut_FatalExit("cannot close file");
-
-        if (cut_arguments.timeout) {
-            signal(SIGALRM, cut_SigAlrm);
-            alarm(cut_arguments.timeout);
-        }
-        cut_ExceptionBypass(testId, subtest);
+        setpgid(0, 0);
+        close(pipefd[0]) != -1 || cut_FatalExit("cannot close file");
+        cut_pipeWrite = pipefd[1];
+        cut_emergencyLog = cut_EmergencyLog(getpid());
+        cut_RunBatch(slot->batch, slot->batchSize);
 
         close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
+        cut_CleanSchedule();
         free(cut_unitTests.tests);
         free(cut_arguments.match);
         if (cut_arguments.output)
             fclose(cut_output);
         exit(cut_NORMAL_EXIT);
     }
-    // parent process only
+    // parent process only; the unit leads its own group so that the watchdog kills its helpers too
+    setpgid(pid, pid);
+    close(pipefd[1]) != -1 || cut_FatalExit("cannot close file");
+    fcntl(pipefd[0], F_SETFL, O_NONBLOCK) != -1 || cut_FatalExit("cannot set non-blocking pipe");
+    slot->pid = pid;
+    slot->pipeRead = pipefd[0];
+}
+
+CUT_PRIVATE void cut_GuardHandler(int signal) {
+    cut_crashSignal = signal;
+    CUT_LONG_JUMP(cut_executionPoint);
+}
+
+CUT_PRIVATE void cut_TimeoutHandler(CUT_UNUSED(int signal)) {
+    // the signal sent just before the unit ended finds nothing to interrupt
+    if (!cut_guardActive)
+        return;
+    cut_guardActive = 0;
+    cut_Timeouted();
+    CUT_LONG_JUMP(cut_executionPoint);
+}
+
+CUT_PRIVATE void *cut_WatchdogMain(CUT_UNUSED(void *data)) {
+    pthread_mutex_lock(&cut_watchdogLock);
+    for (;;) {
+        if (!cut_guardDeadline) {
+            pthread_cond_wait(&cut_watchdogWake, &cut_watchdogLock);
+            continue;
+        }
+        int64_t left = cut_guardDeadline - cut_Now();
+        if (left <= 0) {
+            cut_guardDeadline = 0;
+            pthread_kill(cut_watchdogTarget, CUT_TIMEOUT_SIGNAL);
+            continue;
+        }
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += left / 1000000 + (until.tv_nsec + left % 1000000 * 1000) / 1000000000;
+        until.tv_nsec = (until.tv_nsec + left % 1000000 * 1000) % 1000000000;
+        pthread_cond_timedwait(&cut_watchdogWake, &cut_watchdogLock, &until);
+    }
+    return NULL;
+}
+
+CUT_PRIVATE void cut_StartWatchdog() {
+    // the handler of the timeout stays, a signal sent while the unit was ending may come late
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = cut_TimeoutHandler;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(CUT_TIMEOUT_SIGNAL, &action, NULL) != -1 || cut_FatalExit("cannot set timeout handler");
+
+    // the watchdog takes none of the signals meant for the process
+    sigset_t signals, previous;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attributes, cut_WatchdogMain, NULL) == 0 || cut_FatalExit("cannot start watchdog thread");
+    pthread_attr_destroy(&attributes);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    cut_watchdogStarted = 1;
+}
+
+CUT_PRIVATE void cut_GuardUnit(int testId, int subtest) {
+    if (!cut_alternateStack) {
+        // a stack overflow leaves no room for the handler on the usual stack
+        stack_t stack;
+        memset(&stack, 0, sizeof(stack));
+        stack.ss_size = SIGSTKSZ + 64 * 1024;
+        stack.ss_sp = cut_alternateStack = (char *)malloc(stack.ss_size);
+        if (!cut_alternateStack)
+            cut_FatalExit("cannot allocate alternate signal stack");
+        sigaltstack(&stack, NULL) != -1 || cut_FatalExit("cannot set alternate signal stack");
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = cut_GuardHandler;
+    // the handler never returns, the jump restores the signal mask of the unit
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < cut_GUARDED_SIGNALS; ++i)
+        sigaction(cut_guardedSignals[i], &action, &cut_guardedActions[i]);
+
+    cut_guardTimeout = cut_UnitTimeout(testId, subtest);
+    if (!cut_guardTimeout)
+        return;
+    if (!cut_watchdogStarted)
+        cut_StartWatchdog();
+    cut_watchdogTarget = pthread_self();
+    cut_RearmUnit();
+}
+
+CUT_PRIVATE void cut_RearmUnit() {
+    // the watchdog times the unit the runner runs itself, not units on threads
+    if (!cut_inProcess || !cut_guardTimeout)
+        return;
+    // the unit must not jump away holding the lock, a timeout due just now is postponed anyway
+    cut_guardActive = 0;
+    pthread_mutex_lock(&cut_watchdogLock);
+    cut_guardDeadline = cut_Now() + (int64_t)cut_guardTimeout * 1000;
+    pthread_cond_signal(&cut_watchdogWake);
+    pthread_mutex_unlock(&cut_watchdogLock);
+    cut_guardActive = 1;
+}
+
+CUT_PRIVATE void cut_SyncFile(FILE *file) {
+    fflush(file);
+    fsync(fileno(file));
+}
+
+CUT_PRIVATE void cut_ReleaseUnit() {
+    if (cut_guardTimeout) {
+        cut_guardActive = 0;
+        pthread_mutex_lock(&cut_watchdogLock);
+        cut_guardDeadline = 0;
+        pthread_mutex_unlock(&cut_watchdogLock);
+        cut_guardTimeout = 0;
+    }
+    for (int i = 0; i < cut_GUARDED_SIGNALS; ++i)
+        sigaction(cut_guardedSignals[i], &cut_guardedActions[i], NULL);
+}
+
+// open files and signal handlers of the runner which a unit must leave as they were
+CUT_PRIVATE uint64_t cut_ProcessFingerprint() {
+    // the watchdog belongs to the runner, the unit which happens to start it has not changed anything
+    if (!cut_watchdogStarted)
+        cut_StartWatchdog();
+    uint64_t hash = 14695981039346656037ULL;
+    // threads cannot be listed portably, the lowest descriptors have to do for files
+    for (int fd = 0; fd < 1024; ++fd) {
+        if (fcntl(fd, F_GETFD) != -1)
+            hash = cut_HashBytes(hash, &fd, sizeof(fd));
+    }
+    // handlers are compared by their addresses, flags and masks are left out
+    for (int signal = 1; signal < NSIG; ++signal) {
+        struct sigaction action;
+        if (sigaction(signal, NULL, &action) == -1)
+            continue;
+        uintptr_t handler = (action.sa_flags & SA_SIGINFO)
+            ? (uintptr_t)action.sa_sigaction : (uintptr_t)action.sa_handler;
+        hash = cut_HashBytes(hash, &handler, sizeof(handler));
+    }
+    return hash;
+}
+
+CUT_PRIVATE void cut_KillUnit(int pid) {
+    if (kill(-pid, SIGKILL) == -1)
+        kill(pid, SIGKILL);
+}
+
+CUT_PRIVATE void cut_SeparateIO() {
+    FILE **files[2] = {&cut_stdout, &cut_stderr};
+    for (int i = 0; i < 2; ++i) {
+        FILE *copy = tmpfile();
+        if (!copy)
+            cut_FatalExit("cannot open temporary file");
+        char buffer[4096];
+        off_t offset = 0;
+        int64_t r;
+        while ((r = pread(fileno(*files[i]), buffer, sizeof(buffer), offset)) > 0) {
+            fwrite(buffer, 1, (size_t)r, copy) == (size_t)r || cut_FatalExit("cannot copy output");
+            offset += r;
+        }
+        fflush(copy);
+        dup2(fileno(copy), i + 1) != -1 || cut_FatalExit("cannot redirect output");
+        fclose(*files[i]);
+        *files[i] = copy;
+    }
+}
+
+int cut_Branch(int first, int last, int *current) {
+    // forking a single thread of the runner would not make a unit
+    if (!cut_arguments.forkSubtests || *current || cut_unitThread)
+        return 0;
+    for (int subtest = first; subtest <= last; ++subtest) {
+        fflush(stdout);
+        fflush(stderr);
+        int pid = fork();
+        if (pid == -1)
+            cut_FatalExit("cannot fork");
+        if (!pid) {
+            setpgid(0, 0);
+            cut_SeparateIO();
+            cut_SendBranch(subtest, getpid());
+            cut_branched = 1;
+            *current = subtest;
+            return 1;
+        }
+        int status = 0;
+        int r;
+        do {
+            r = waitpid(pid, &status, 0);
+        } while (r == -1 && errno == EINTR);
+        r != -1 || cut_FatalExit("cannot wait for subtest");
+        cut_SendStatus(WIFEXITED(status) ? WEXITSTATUS(status) : 0,
+                       WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    }
+    return 0;
+}
+
+CUT_PRIVATE void cut_DrainUnit(struct cut_Slot *slot) {
+    char buffer[4096];
+    for (;;) {
+        int64_t r = read(slot->pipeRead, buffer, sizeof(buffer));
+        if (r > 0) {
+            cut_SlotFeed(slot, buffer, (size_t)r);
+            continue;
+        }
+        if (r == -1 && errno == EINTR)
+            continue;
+        if (r == -1 && errno != EAGAIN)
+            cut_FatalExit("cannot read message");
+        if (!r)
+            slot->eof = 1;
+        return;
+    }
+}
+
+CUT_PRIVATE void cut_ReapUnit(struct cut_Slot *slot) {
     int status = 0;
-    close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
-    cut_PipeReader(result);
+    struct rusage usage;
+    int r;
     do {
-        r = waitpid( pid, &status, 0 );
+        r = wait4(slot->pid, &status, 0, &usage);
     } while (r == -1 && errno == EINTR);
     r != -1 || cut_FatalExit("cannot wait for unit");
-    result->returnCode = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
-    result->signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
-    result->failed |= result->returnCode ||  result->signal;
-    close(cut_pipeRead) != -1 || cut_FatalExit("cannot close file");
+    slot->exited = 1;
+    // the peak of a batch cannot be told apart among its units
+    if (slot->batchSize == 1)
+# if defined(__APPLE__)
+        slot->result.memory = usage.ru_maxrss / 1024;
+# else
+        slot->result.memory = usage.ru_maxrss;
+# endif
+    slot->result.returnCode = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+    slot->result.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    slot->result.failed |= slot->result.returnCode || slot->result.signal;
+}
+
+CUT_PRIVATE void cut_WaitForUnits(struct cut_Slot *slots, int count, int timeout) {
+    struct pollfd *fds = (struct pollfd *)malloc(count * sizeof(struct pollfd));
+    struct cut_Slot **owners = (struct cut_Slot **)malloc(count * sizeof(struct cut_Slot *));
+    if (!fds || !owners)
+        cut_FatalExit("cannot allocate memory for poll");
+
+    int size = 0;
+    for (int i = 0; i < count; ++i) {
+        if (slots[i].state != cut_SLOT_RUNNING || slots[i].eof)
+            continue;
+        fds[size].fd = slots[i].pipeRead;
+        fds[size].events = POLLIN;
+        owners[size++] = &slots[i];
+    }
+
+    int r;
+    do {
+        r = poll(fds, size, timeout);
+    } while (r == -1 && errno == EINTR);
+    r != -1 || cut_FatalExit("cannot poll units");
+
+    for (int i = 0; r > 0 && i < size; ++i) {
+        if (fds[i].revents)
+            cut_DrainUnit(owners[i]);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        struct cut_Slot *slot = &slots[i];
+        if (slot->state != cut_SLOT_RUNNING || !slot->eof)
+            continue;
+        if (!slot->exited)
+            cut_ReapUnit(slot);
+        close(slot->pipeRead) != -1 || cut_FatalExit("cannot close file");
+        slot->state = cut_SLOT_DONE;
+    }
+    free(fds);
+    free(owners);
 }
 
 CUT_PRIVATE int cut_ReadWholeFile(int fd, char **buffer, size_t *length) {
@@ -130,6 +577,16 @@ cleanup:
     return result;
 }
 
+CUT_PRIVATE int cut_MakeDirectory(const char *path) {
+    return mkdir(path, 0777) != -1 || errno == EEXIST;
+}
+
+CUT_PRIVATE int cut_HashTests(uint64_t *keys) {
+    // the code of tests is not looked up here, the cache is not available
+    (void)keys;
+    return 0;
+}
+
 int cut_File(FILE *f, const char *content) {
     int result = 0;
     size_t length = strlen(content);
@@ -168,6 +625,38 @@ CUT_PRIVATE int cut_IsDebugger() {
     return (info.kp_proc.p_flag & P_TRACED);
 }
 
+// there is no portable notification, the binary and the directories are looked at periodically
+CUT_PRIVATE void cut_WaitForChange() {
+    struct stat info;
+    for (int i = 0; i < cut_arguments.watchDirCount; ++i) {
+        if (stat(cut_arguments.watchDirs[i], &info) || !S_ISDIR(info.st_mode))
+            cut_ErrorExit("cannot watch directory %s", cut_arguments.watchDirs[i]);
+    }
+    // the stamp is taken at the start, a relink during the run or the summary is not missed
+    uint64_t stamp = cut_watchedStamp;
+    uint64_t current = cut_WatchedStamp();
+    while (current == stamp) {
+        usleep(CUT_WATCH_SETTLE * 1000);
+        current = cut_WatchedStamp();
+    }
+    // a build writes many files, the run starts once they settle down
+    do {
+        stamp = current;
+        usleep(CUT_WATCH_SETTLE * 1000);
+        current = cut_WatchedStamp();
+    } while (current != stamp);
+}
+
+CUT_PRIVATE void cut_Restart(char **argv) {
+    for (;;) {
+        cut_WaitForChange();
+        execvp(argv[0], argv);
+        // the binary may be half-written or gone while the build goes on
+        fprintf(stderr, "Cannot run %s again, waiting for the next change.\n", argv[0]);
+        cut_watchedStamp = cut_WatchedStamp();
+    }
+}
+
 CUT_PRIVATE int cut_PrintColorized(enum cut_Colors color, const char *text) {
     const char *prefix;
     const char *suffix = "\x1B[0m";
@@ -5,6 +5,7 @@
 # define CUT_NORETURN __attribute__((noreturn))
 # define CUT_CONSTRUCTOR(name) __attribute__((constructor)) static void name()
 # define CUT_UNUSED(name) __attribute__((unused)) name
+# define CUT_THREAD_LOCAL __thread
 #elif defined(_MSC_VER)
 
 # define CUT_NORETURN __declspec(noreturn)
@@ -16,10 +17,15 @@
 
 
 # define CUT_UNUSED(name) name
+# define CUT_THREAD_LOCAL __declspec(thread)
 #else
 # error "unsupported compiler"
 #endif
 
+# define CUT_JUMP_BUFFER jmp_buf
+# define CUT_SET_JUMP(point) setjmp(point)
+# define CUT_LONG_JUMP(point) longjmp(point, 1)
+
 #if defined(__clang__)
 # pragma clang system_header
 #elif defined(__GNUC__)
@@ -6,6 +6,8 @@
 # include <fcntl.h>
 
 CUT_PRIVATE HANDLE cut_jobGroup;
+CUT_PRIVATE HANDLE cut_unitTimer = NULL;
+CUT_PRIVATE unsigned cut_unitTimeout = 0;
 
 CUT_PRIVATE int cut_IsDebugger() {
     return IsDebuggerPresent();
@@ -58,6 +60,15 @@ CUT_PRIVATE void NTAPI cut_TimerCallback(CUT_UNUSED(void *param), CUT_UNUSED(BOO
 }
 
 CUT_PRIVATE int cut_PreRun() {
+    // there is no fork, units are always run by separate processes
+    cut_arguments.forkSubtests = 0;
+    cut_arguments.spawn = 1;
+    cut_arguments.batch = 1;
+    cut_arguments.autoIsolate = 0;
+    cut_arguments.threads = 0;
+    cut_arguments.privateDir = 0;
+    cut_arguments.sandbox = 0;
+    cut_arguments.watch = 0;
     if (!cut_arguments.noFork && cut_arguments.testId < 0) {
         // create a group of processes to be able to kill unit when parent dies
 		cut_jobGroup = CreateJobObject(NULL, NULL);
@@ -72,21 +83,28 @@ CUT_PRIVATE int cut_PreRun() {
 
     SetErrorMode(SEM_NOGPFAULTERRORBOX);
 
-    HANDLE timer = NULL;
-    if (cut_arguments.timeout) {
-        CreateTimerQueueTimer(&timer, NULL, cut_TimerCallback, NULL, 
-                              cut_arguments.timeout * 1000, 0, WT_EXECUTEONLYONCE) || cut_FatalExit("cannot create timer");
+    cut_unitTimeout = cut_UnitTimeout(cut_arguments.testId, cut_arguments.subtestId);
+    if (cut_unitTimeout) {
+        CreateTimerQueueTimer(&cut_unitTimer, NULL, cut_TimerCallback, NULL,
+                              cut_unitTimeout, 0, WT_EXECUTEONLYONCE) || cut_FatalExit("cannot create timer");
     }
 
     cut_pipeWrite = _dup(1);
     _setmode(cut_pipeWrite, _O_BINARY);
+    if (cut_globalSetupOnce) {
+        // standard output is the pipe to the runner
+        cut_RedirectIO();
+        cut_globalSetupOnce();
+        cut_ResumeIO();
+    }
 
     cut_ExceptionBypass(cut_arguments.testId, cut_arguments.subtestId);
 
     _close(cut_pipeWrite) != -1 || cut_FatalExit("cannot close file");
 
-    if (timer) {
-        DeleteTimerQueueTimer(NULL, timer, NULL) || cut_FatalExit("cannot delete timer");
+    if (cut_unitTimer) {
+        DeleteTimerQueueTimer(NULL, cut_unitTimer, NULL) || cut_FatalExit("cannot delete timer");
+        cut_unitTimer = NULL;
     }
 
     return 1;
@@ -115,11 +133,12 @@ CUT_PRIVATE void cut_RunUnit(int testId, int subtest, struct cut_UnitResult *res
     startInfo.dwFlags |= STARTF_USESTDHANDLES;
     startInfo.hStdOutput = childOutWrite;
 
-    const char *fmtString = "\"%s\" --test %i --subtest %i --timeout %i";
-    int length = snprintf(NULL, 0, fmtString, cut_arguments.selfName, testId, subtest,
-                          cut_arguments.timeout);
+    const char *fmtString = "\"%s\" --test %i --subtest %i --timeout %ums";
+    // the unit does not read the history, it gets its timeout from the runner
+    unsigned timeout = cut_UnitTimeout(testId, subtest);
+    int length = snprintf(NULL, 0, fmtString, cut_arguments.selfName, testId, subtest, timeout);
     char *command = (char *)malloc(length + 1);
-    sprintf(command, fmtString, cut_arguments.selfName, testId, subtest, cut_arguments.timeout);
+    sprintf(command, fmtString, cut_arguments.selfName, testId, subtest, timeout);
             
     CreateProcessA(cut_arguments.selfName,
                    command,
@@ -153,6 +172,84 @@ CUT_PRIVATE void cut_RunUnit(int testId, int subtest, struct cut_UnitResult *res
     _close(cut_pipeRead) != -1 || cut_FatalExit("cannot close file");
 }
 
+CUT_PRIVATE int cut_ProcessorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+CUT_PRIVATE int cut_ReadPressure(CUT_UNUSED(struct cut_Pressure *pressure)) {
+    return 0;
+}
+
+// units are run one by one, the scheduler gets them already finished
+CUT_PRIVATE int64_t cut_Now() {
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (int64_t)(counter.QuadPart * 1000000 / frequency.QuadPart);
+}
+
+CUT_PRIVATE void cut_KillUnit(CUT_UNUSED(int pid)) {
+}
+
+// every unit has a process of its own, crashes and timeouts are handled by the timer and the exit code
+CUT_PRIVATE void cut_GuardUnit(CUT_UNUSED(int testId), CUT_UNUSED(int subtest)) {
+}
+
+CUT_PRIVATE void cut_ReleaseUnit() {
+}
+
+CUT_PRIVATE void cut_SyncFile(FILE *file) {
+    fflush(file);
+    _commit(_fileno(file));
+}
+
+// the unit watches its own timeout, a heartbeat postpones it
+CUT_PRIVATE void cut_RearmUnit() {
+    if (cut_unitTimer)
+        ChangeTimerQueueTimer(NULL, cut_unitTimer, cut_unitTimeout, 0) || cut_FatalExit("cannot change timer");
+}
+
+CUT_PRIVATE uint64_t cut_ProcessFingerprint() {
+    return 0;
+}
+
+CUT_PRIVATE void cut_LaunchThread(CUT_UNUSED(struct cut_Slot *slot)) {
+}
+
+CUT_PRIVATE char *cut_MakePrivateRoot() {
+    return NULL;
+}
+
+CUT_PRIVATE void cut_EnterPrivateDir(CUT_UNUSED(int testId), CUT_UNUSED(int subtest), CUT_UNUSED(int index)) {
+}
+
+CUT_PRIVATE void cut_RemoveTree(CUT_UNUSED(const char *path)) {
+}
+
+int cut_Branch(CUT_UNUSED(int first), CUT_UNUSED(int last), CUT_UNUSED(int *current)) {
+    return 0;
+}
+
+// every unit is a new process which does the setup on its own
+CUT_PRIVATE void cut_StartZygote() {
+    if (cut_globalSetupOnce && cut_arguments.noFork)
+        cut_globalSetupOnce();
+}
+
+CUT_PRIVATE void cut_StopZygote() {
+}
+
+CUT_PRIVATE void cut_LaunchUnit(struct cut_Slot *slot) {
+    cut_RunUnit(slot->unit.testId, slot->unit.subtest, &slot->result);
+    slot->state = cut_SLOT_DONE;
+}
+
+CUT_PRIVATE void cut_WaitForUnits(CUT_UNUSED(struct cut_Slot *slots), CUT_UNUSED(int count),
+                                  CUT_UNUSED(int timeout)) {
+}
+
 CUT_PRIVATE int cut_ReadWholeFile(int fd, char *buffer, size_t length) {
     while (length) {
         int64_t rv = _read(fd, buffer, length);
@@ -164,6 +261,16 @@ CUT_PRIVATE int cut_ReadWholeFile(int fd, char *buffer, size_t length) {
     return 0;
 }
 
+CUT_PRIVATE int cut_MakeDirectory(const char *path) {
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+CUT_PRIVATE int cut_HashTests(uint64_t *keys) {
+    // the code of tests is not looked up here, the cache is not available
+    (void)keys;
+    return 0;
+}
+
 int cut_File(FILE *f, const char *content) {
     int result = 0;
     size_t length = strlen(content);
@@ -189,6 +296,10 @@ cleanup:
     return result;
 }
 
+// there is no watch mode, the run just ends
+CUT_PRIVATE void cut_Restart(CUT_UNUSED(char **argv)) {
+}
+
 CUT_PRIVATE int cut_PrintColorized(enum cut_Colors color, const char *text) {
     HANDLE stdOut = GetStdHandle(STD_OUTPUT_HANDLE);
     CONSOLE_SCREEN_BUFFER_INFO info;
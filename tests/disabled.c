@@ -0,0 +1,38 @@
+/* A test file compiled without the framework (no CUT, DEBUG or CUT_MAIN)
+   has to build: every macro turns into nothing.
+ */
+#undef CUT
+#include <cut.h>
+
+TEST(plain) {
+    ASSERT(1);
+    CHECK(1);
+    DEBUG_MSG("%d", 1);
+}
+
+TEST_TIMEOUT(progress, 100) {
+    for (int i = 0; i < 3; ++i) {
+        CUT_PROGRESS();
+        cut_Heartbeat(i);
+    }
+}
+
+TEST_THREADSAFE(threadSafe) {
+    SUBTEST(one) {
+        ASSERT(SUBTEST_NO == 0);
+    }
+}
+
+TEST_RESOURCES(resources, "port:8080") {
+    REPEATED_SUBTEST(round, 2) {
+        CHECK(1);
+    }
+}
+
+int main() {
+    unitTest_plain();
+    unitTest_progress();
+    unitTest_threadSafe();
+    unitTest_resources();
+    return 0;
+}
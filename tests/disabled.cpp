@@ -0,0 +1 @@
+#include "disabled.c"
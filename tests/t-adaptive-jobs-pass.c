@@ -0,0 +1,19 @@
+#include <cut.h>
+
+// with equal bounds the limit cannot move, the summary of jobs is the same on any machine
+TEST(first) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two) {
+        ASSERT(1);
+    }
+}
+
+TEST(last) {
+    ASSERT(1);
+}
@@ -0,0 +1,30 @@
+#include <cut.h>
+#include <time.h>
+
+static int spin(long milliseconds) {
+    clock_t end = clock() + milliseconds * CLOCKS_PER_SEC / 1000;
+    while (clock() < end);
+    return 1;
+}
+
+// units which take as long as they always do are not killed by timeouts learnt from the history
+TEST(fast) {
+    ASSERT(spin(1));
+}
+
+TEST(slower) {
+    ASSERT(spin(20));
+}
+
+TEST_TIMEOUT(explicit, 2000) {
+    ASSERT(spin(5));
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(spin(1));
+    }
+    SUBTEST(two) {
+        ASSERT(spin(10));
+    }
+}
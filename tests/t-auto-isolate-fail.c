@@ -0,0 +1,30 @@
+#include <cut.h>
+#include <stdio.h>
+
+TEST(first) {
+    ASSERT(1);
+}
+
+TEST(crashing) {
+    int *volatile pointer = NULL;
+    *pointer = 1;
+}
+
+TEST(leaking) {
+    // the file stays open in the runner, the isolated run passes
+    FILE *file = tmpfile();
+    ASSERT(file);
+}
+
+TEST(global) {
+    SUBTEST(passing) {
+        ASSERT(1);
+    }
+    SUBTEST(failing) {
+        ASSERT(0);
+    }
+}
+
+TEST(last) {
+    ASSERT(1);
+}
@@ -0,0 +1,34 @@
+#include <cut.h>
+#include <stdlib.h>
+
+TEST(first) {
+    printf("leftover");
+    ASSERT(1);
+}
+
+TEST(stdout) {
+    printf("own");
+    ASSERT_FILE(stdout, "own");
+}
+
+TEST(crash) {
+    int *i = NULL;
+    *i = 1;
+}
+
+TEST(subtests) {
+    SUBTEST(pass) {
+        ASSERT(1);
+    }
+    SUBTEST(fail) {
+        ASSERT(0);
+    }
+}
+
+TEST(exit) {
+    exit(3);
+}
+
+TEST(last) {
+    DEBUG_MSG("done");
+}
@@ -0,0 +1,15 @@
+#include <cut.h>
+
+// the first run fills the cache, --no-cache runs every test anyway
+TEST(first) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two and three) {
+        ASSERT(1);
+    }
+}
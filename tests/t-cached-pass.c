@@ -0,0 +1,15 @@
+#include <cut.h>
+
+// the first run fills the cache, the checked run takes both tests from it
+TEST(first) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two and three) {
+        ASSERT(1);
+    }
+}
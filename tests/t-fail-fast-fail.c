@@ -0,0 +1,25 @@
+#include <cut.h>
+
+TEST(first) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(passing) {
+        ASSERT(1);
+    }
+    SUBTEST(failing) {
+        ASSERT(0);
+    }
+    SUBTEST(never) {
+        ASSERT(1);
+    }
+}
+
+TEST(failing) {
+    ASSERT(0);
+}
+
+TEST(last) {
+    ASSERT(1);
+}
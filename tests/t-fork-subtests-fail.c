@@ -0,0 +1,35 @@
+#include <cut.h>
+#include <stdio.h>
+
+TEST(prefixOnce) {
+    int i = 1;
+    DEBUG_MSG("prefix");
+    printf("prefix ");
+    SUBTEST(first) {
+        printf("first");
+        ASSERT_FILE(stdout, "prefix first");
+    }
+    ++i;
+    SUBTEST(second) {
+        ASSERT(i == 2);
+        ASSERT_FILE(stdout, "prefix ");
+    }
+    ++i;
+    SUBTEST(crashing) {
+        int *n = NULL;
+        *n = i;
+    }
+    SUBTEST(hanging) {
+        while (1);
+    }
+    SUBTEST(last) {
+        CHECK(i == 4);
+    }
+    ASSERT(i == 3);
+}
+
+TEST(repeated) {
+    REPEATED_SUBTEST(round, 3) {
+        ASSERT(SUBTEST_NO != 2);
+    }
+}
@@ -0,0 +1,31 @@
+#include <cut.h>
+#include <time.h>
+
+static void spin(long milliseconds) {
+    clock_t end = clock() + milliseconds * CLOCKS_PER_SEC / 1000;
+    while (clock() < end);
+}
+
+// the units run longer than their timeout, which counts from the last report of progress
+TEST(steps) {
+    for (int i = 0; i < 8; ++i) {
+        spin(100);
+        CUT_PROGRESS();
+    }
+}
+
+TEST(counted) {
+    SUBTEST(forward) {
+        for (int i = 1; i <= 8; ++i) {
+            spin(100);
+            cut_Heartbeat(i);
+        }
+    }
+    SUBTEST(often) {
+        for (int i = 0; i < 80000; ++i) {
+            if (i % 100 == 0)
+                spin(1);
+            CUT_PROGRESS();
+        }
+    }
+}
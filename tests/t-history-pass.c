@@ -0,0 +1,19 @@
+#include <cut.h>
+
+TEST(first) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(short) {
+        ASSERT(1);
+    }
+    SUBTEST(long) {
+        for (volatile int i = 0; i < 10000000; ++i);
+        ASSERT(1);
+    }
+}
+
+TEST(last) {
+    DEBUG_MSG("done");
+}
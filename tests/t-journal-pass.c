@@ -0,0 +1,22 @@
+#include <cut.h>
+
+// the first run writes the journal, the checked run takes all results of units from it
+TEST(plain) {
+    DEBUG_MSG("kept in the journal");
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two with spaces) {
+        ASSERT(2);
+    }
+}
+
+TEST(repeated) {
+    REPEATED_SUBTEST(round, 3) {
+        ASSERT(SUBTEST_NO > 0);
+    }
+}
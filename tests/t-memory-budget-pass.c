@@ -0,0 +1,34 @@
+#include <cut.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int eat(size_t megabytes) {
+    // touched pages count into the peak recorded in the history
+    size_t size = megabytes << 20;
+    char *memory = (char *)malloc(size);
+    if (!memory)
+        return 0;
+    memset(memory, 1, size);
+    int sum = 0;
+    for (size_t i = 0; i < size; i += 4096)
+        sum += memory[i];
+    free(memory);
+    return sum == (int)(size / 4096);
+}
+
+TEST(first) {
+    ASSERT(eat(32));
+}
+
+TEST(second) {
+    ASSERT(eat(32));
+}
+
+TEST(small) {
+    SUBTEST(one) {
+        ASSERT(eat(1));
+    }
+    SUBTEST(two) {
+        ASSERT(eat(1));
+    }
+}
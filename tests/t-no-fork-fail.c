@@ -0,0 +1,24 @@
+#include <cut.h>
+
+TEST(crashing) {
+    int *volatile pointer = NULL;
+    *pointer = 1;
+}
+
+TEST_TIMEOUT(hanging, 100) {
+    while (1);
+}
+
+TEST(global) {
+    SUBTEST(crashing) {
+        int *volatile pointer = NULL;
+        *pointer = 1;
+    }
+    SUBTEST(passing) {
+        ASSERT(1);
+    }
+}
+
+TEST(last) {
+    ASSERT(1);
+}
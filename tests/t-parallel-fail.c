@@ -0,0 +1,31 @@
+#include <cut.h>
+#include <time.h>
+
+static void spin(double seconds) {
+    clock_t end = clock() + (clock_t)(seconds * CLOCKS_PER_SEC);
+    while (clock() < end);
+}
+
+TEST(slow) {
+    spin(0.3);
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(slow) {
+        spin(0.2);
+        ASSERT(0);
+    }
+    SUBTEST(fast) {
+        ASSERT(1);
+    }
+}
+
+TEST(fast) {
+    int *i = NULL;
+    *i = 1;
+}
+
+TEST(last) {
+    DEBUG_MSG("done");
+}
@@ -0,0 +1,36 @@
+#include <cut.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int fresh() {
+    // every unit starts in an empty directory, files of the others are not there
+    FILE *file = fopen("data.txt", "r");
+    if (file) {
+        fclose(file);
+        return 0;
+    }
+    file = fopen("data.txt", "w");
+    if (!file)
+        return 0;
+    fputs("data", file);
+    fclose(file);
+    return 1;
+}
+
+TEST(first) {
+    ASSERT(getenv("CUT_TEST_DIR"));
+    ASSERT(fresh());
+}
+
+TEST(second) {
+    ASSERT(fresh());
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(fresh());
+    }
+    SUBTEST(two) {
+        ASSERT(fresh());
+    }
+}
@@ -0,0 +1,14 @@
+#include <cut.h>
+
+TEST(passing) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(passing) {
+        ASSERT(1);
+    }
+    SUBTEST(failing) {
+        ASSERT(0);
+    }
+}
@@ -0,0 +1,22 @@
+#include <cut.h>
+
+// the first run records the failed subtest, the checked run repeats only that one
+TEST(passing) {
+    ASSERT(1);
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two) {
+        ASSERT(1 == 2);
+    }
+    SUBTEST(three) {
+        ASSERT(1);
+    }
+}
+
+TEST(last) {
+    ASSERT(1);
+}
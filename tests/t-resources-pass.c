@@ -0,0 +1,35 @@
+#include <cut.h>
+#include <stdio.h>
+
+static int hold(const char *name) {
+    // the lock cannot be created twice, two holders at once would fail here
+    FILE *lock = fopen(name, "wx");
+    if (!lock)
+        return 0;
+    fclose(lock);
+    for (volatile long i = 0; i < 20000000; ++i);
+    remove(name);
+    return 1;
+}
+
+TEST_RESOURCES(first, "file:scratch") {
+    ASSERT(hold("t-resources-scratch.lock"));
+}
+
+TEST_RESOURCES(second, "file:scratch", "port:8080") {
+    ASSERT(hold("t-resources-scratch.lock"));
+    ASSERT(hold("t-resources-port.lock"));
+}
+
+TEST_RESOURCES(third, "port:8080") {
+    SUBTEST(one) {
+        ASSERT(hold("t-resources-port.lock"));
+    }
+    SUBTEST(two) {
+        ASSERT(hold("t-resources-port.lock"));
+    }
+}
+
+TEST(free) {
+    ASSERT(1);
+}
@@ -0,0 +1,52 @@
+#include <cut.h>
+
+#if defined(__linux__)
+# include <unistd.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+
+static int hold(unsigned short port) {
+    // each unit has its own loopback, units holding the same port do not collide
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1)
+        return 0;
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int bound = bind(sock, (struct sockaddr *)&address, sizeof(address)) == 0 && listen(sock, 1) == 0;
+    for (volatile long i = 0; bound && i < 20000000; ++i);
+    close(sock);
+    return bound;
+}
+#else
+static int hold(unsigned short port) {
+    return port;
+}
+#endif
+
+TEST(first) {
+    ASSERT(hold(8080));
+}
+
+TEST(second) {
+    ASSERT(hold(8080));
+}
+
+TEST(third) {
+    SUBTEST(one) {
+        ASSERT(hold(8080));
+    }
+    SUBTEST(two) {
+        ASSERT(hold(8080));
+    }
+}
+
+TEST(namespace) {
+#if defined(__linux__)
+    ASSERT(getppid() == 1);
+#endif
+}
@@ -0,0 +1,28 @@
+#include <cut.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *dictionary = NULL;
+static int setups = 0;
+
+GLOBAL_SETUP_ONCE() {
+    dictionary = (char *)malloc(16);
+    strcpy(dictionary, "expensive");
+    ++setups;
+}
+
+TEST(first) {
+    ASSERT(dictionary);
+    ASSERT(!strcmp(dictionary, "expensive"));
+    ASSERT(setups == 1);
+    dictionary[0] = 'E';
+}
+
+TEST(second) {
+    SUBTEST(inherited) {
+        ASSERT(!strcmp(dictionary, "expensive"));
+    }
+    SUBTEST(isolated) {
+        ASSERT(setups == 1);
+    }
+}
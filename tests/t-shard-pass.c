@@ -0,0 +1,30 @@
+#include <cut.h>
+
+TEST(alpha) {
+    ASSERT(1);
+}
+
+TEST(beta) {
+    ASSERT(1);
+}
+
+TEST(gamma) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two) {
+        ASSERT(1);
+    }
+}
+
+TEST(delta) {
+    ASSERT(1);
+}
+
+TEST(epsilon) {
+    ASSERT(1);
+}
+
+TEST(zeta) {
+    ASSERT(1);
+}
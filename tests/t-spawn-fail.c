@@ -0,0 +1,37 @@
+#include <cut.h>
+#include <stdlib.h>
+
+// failures of units started by --spawn come back through the pipe or the exit status
+TEST(failing) {
+    ASSERT(1 == 2);
+}
+
+TEST(crashing) {
+    int *volatile pointer = NULL;
+    *pointer = 1;
+}
+
+TEST(exiting) {
+    exit(3);
+}
+
+TEST_TIMEOUT(hanging, 100) {
+    while (1);
+}
+
+TEST(subtests) {
+    SUBTEST(passing) {
+        ASSERT(1);
+    }
+    SUBTEST(checking) {
+        CHECK(0);
+    }
+    SUBTEST(crashing) {
+        int *volatile pointer = NULL;
+        *pointer = 1;
+    }
+}
+
+TEST(last) {
+    ASSERT(1);
+}
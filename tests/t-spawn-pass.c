@@ -0,0 +1,29 @@
+#include <cut.h>
+#include <stdio.h>
+
+// every unit is a new process of the binary which gets its unit by arguments
+TEST(passing) {
+    DEBUG_MSG("run by %s", "a new process");
+    ASSERT(1);
+}
+
+TEST(output) {
+    printf("hello");
+    fflush(stdout);
+    ASSERT_FILE(stdout, "hello");
+}
+
+TEST(subtests) {
+    SUBTEST(one) {
+        ASSERT(1);
+    }
+    SUBTEST(two) {
+        ASSERT(2);
+    }
+}
+
+TEST(repeated) {
+    REPEATED_SUBTEST(round, 3) {
+        ASSERT(SUBTEST_NO > 0);
+    }
+}
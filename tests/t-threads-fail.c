@@ -0,0 +1,35 @@
+#include <cut.h>
+
+static int sum(int n) {
+    int result = 0;
+    for (int i = 1; i <= n; ++i)
+        result += i;
+    return result;
+}
+
+TEST_THREADSAFE(first) {
+    ASSERT(sum(10) == 55);
+}
+
+TEST_THREADSAFE(subtests) {
+    SUBTEST(passing) {
+        ASSERT(sum(3) == 6);
+    }
+    SUBTEST(failing) {
+        ASSERT(sum(3) == 7);
+    }
+    SUBTEST(checked) {
+        DEBUG_MSG("sum is %d", sum(4));
+        CHECK(sum(4) == 11);
+    }
+}
+
+TEST(process) {
+    ASSERT(1);
+}
+
+TEST_THREADSAFE(last) {
+    REPEATED_SUBTEST(repeated, 3) {
+        ASSERT(sum(SUBTEST_NO) > 0);
+    }
+}
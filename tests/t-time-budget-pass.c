@@ -0,0 +1,26 @@
+#include <cut.h>
+#include <time.h>
+
+static int spin(long milliseconds) {
+    // the budget is over once this unit is done, nothing else is started
+    clock_t end = clock() + milliseconds * CLOCKS_PER_SEC / 1000;
+    while (clock() < end);
+    return 1;
+}
+
+TEST(first) {
+    ASSERT(spin(300));
+}
+
+TEST(second) {
+    ASSERT(spin(1));
+}
+
+TEST(third) {
+    SUBTEST(one) {
+        ASSERT(spin(1));
+    }
+    SUBTEST(two) {
+        ASSERT(spin(1));
+    }
+}
@@ -0,0 +1,18 @@
+#include <cut.h>
+
+TEST_TIMEOUT(custom, 100) {
+    while (1);
+}
+
+TEST_TIMEOUT(fastEnough, 2000) {
+    ASSERT(1);
+}
+
+TEST(global) {
+    SUBTEST(hanging) {
+        while (1);
+    }
+    SUBTEST(passing) {
+        ASSERT(1);
+    }
+}
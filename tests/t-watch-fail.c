@@ -0,0 +1,21 @@
+#include <cut.h>
+#include <time.h>
+
+static void spin(long milliseconds) {
+    clock_t end = clock() + milliseconds * CLOCKS_PER_SEC / 1000;
+    while (clock() < end);
+}
+
+// the first run times the slow test out, the watched run reports it as fixed and stops on the missing directory
+TEST(slow) {
+    spin(300);
+    ASSERT(1);
+}
+
+TEST(failing) {
+    ASSERT(1 == 2);
+}
+
+TEST(passing) {
+    ASSERT(1);
+}